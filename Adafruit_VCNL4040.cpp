@@ -37,10 +37,58 @@
 
 #include "Adafruit_VCNL4040.h"
 
+#define VCNL4040_MAX_REGISTER_READS 4 ///< Most registers `readAll` reads
+
+#if defined(ESP8266) || defined(ESP32)
+#define VCNL4040_ISR_ATTR IRAM_ATTR ///< Place handler in IRAM
+#else
+#define VCNL4040_ISR_ATTR ///< No attribute needed for interrupt handlers
+#endif
+
+// the instance notified by the handler attached with `attachInterruptPin`
+static Adafruit_VCNL4040 *interrupt_instance = NULL;
+
+// the interrupt status bits, in the order of the `_interrupt_callbacks` array
+static const uint8_t interrupt_types[] = {
+    VCNL4040_PROXIMITY_AWAY, VCNL4040_PROXIMITY_CLOSE, VCNL4040_AMBIENT_HIGH,
+    VCNL4040_AMBIENT_LOW, VCNL4040_PROXIMITY_PROTECT_MODE};
+
+// proximity integration times in units of T/2, where 1T is roughly 125us
+static const uint8_t proximity_half_t[] = {2, 3, 4, 5, 6, 7, 8, 16};
+
+// proximity LED currents in mA, indexed by `VCNL4040_LEDCurrent`
+static const uint8_t led_current_ma[] = {50, 75, 100, 120, 140, 160, 180, 200};
+
 /*!
  *    @brief  Instantiates a new VCNL4040 class
  */
-Adafruit_VCNL4040::Adafruit_VCNL4040(void) {}
+Adafruit_VCNL4040::Adafruit_VCNL4040(void)
+    : PS_CONFIG_12(&_ps_config_12_register), ALS_CONFIG(&_als_config_register),
+      PS_MS(&_ps_ms_register), _i2c_dev(VCNL4040_I2CADDR_DEFAULT, &Wire),
+      _als_config_register(&_i2c_dev, VCNL4040_ALS_CONFIG, 2),
+      _ps_config_12_register(&_i2c_dev, VCNL4040_PS_CONF1_L, 2),
+      _ps_ms_register(&_i2c_dev, VCNL4040_PS_MS_H, 2), _als_config(0),
+      _ps_config_12(0), _ps_ms(0), _wait_start_ms(), _wait_ms(),
+      _data_waiting(0), _als_settle_start_ms(0), _als_settle_wait_ms(0),
+      _als_settling(false), _interrupt_pending(false), _interrupt_pin(-1),
+      _capture_interrupt_samples(false), _ps_trigger_pending(false),
+      _als_auto_range(false), _als_auto_low(4000), _als_auto_high(60000),
+      _als_change_detection(false), _als_change_percent(false),
+      _als_change_window(100), _als_change_min_window(10), _als_thdl(0),
+      _als_thdh(0), _als_thresholds_known(0), _config_batch(false),
+      _batch_als_config(0), _batch_ps_config_12(0), _batch_ps_ms(0),
+      _sample_listeners(NULL), _operation_callback(NULL),
+      _operation(VCNL4040_OPERATION_NONE),
+      _operation_status(VCNL4040_STATUS_IDLE), _als_settle_pending(false),
+      _calibration(NULL), _calibration_sum(0), _calibration_max(0),
+      _calibration_margin(0), _calibration_samples(0), _calibration_count(0),
+      _retry_limit(0), _last_transaction_ok(true), _cache_enabled(false),
+      _cache_valid(0), _readings(), _light_integration() {
+  for (uint8_t i = 0; i < sizeof(interrupt_types); i++) {
+    _interrupt_callbacks[i] = NULL;
+  }
+  resetBusStats();
+}
 
 /*!
  *    @brief  Sets up the hardware and initializes I2C
@@ -48,37 +96,67 @@ Adafruit_VCNL4040::Adafruit_VCNL4040(void) {}
  *            The I2C address to be used.
  *    @param  wire
  *            The Wire object to be used for I2C connections.
+ *    @param  calibration
+ *            A proximity calibration saved from `calibrateProximity` to
+ *            restore, or NULL to leave the proximity cancellation and
+ *            thresholds unchanged. An invalid calibration is skipped; check
+ *            it with `calibrationValid` to know whether to recalibrate.
+ *    @return True if initialization was successful, otherwise false.
+ */
+boolean Adafruit_VCNL4040::begin(uint8_t i2c_address, TwoWire *wire,
+                                 const VCNL4040_Calibration *calibration) {
+  return begin(VCNL4040_Config(), i2c_address, wire, calibration);
+}
+
+/*!
+ *    @brief  Sets up the hardware and initializes I2C, then applies a
+ *            configuration with one write per configuration register
+ *    @param  config
+ *            The `VCNL4040_Config` to apply
+ *    @param  i2c_address
+ *            The I2C address to be used.
+ *    @param  wire
+ *            The Wire object to be used for I2C connections.
+ *    @param  calibration
+ *            A proximity calibration saved from `calibrateProximity` to
+ *            restore, or NULL to leave the proximity cancellation unchanged.
+ *            Its thresholds replace any set in `config`. An invalid
+ *            calibration is skipped; check it with `calibrationValid` to
+ *            know whether to recalibrate.
  *    @return True if initialization was successful, otherwise false.
  */
-boolean Adafruit_VCNL4040::begin(uint8_t i2c_address, TwoWire *wire) {
-  i2c_dev = new Adafruit_I2CDevice(i2c_address, wire);
+boolean Adafruit_VCNL4040::begin(const VCNL4040_Config &config,
+                                 uint8_t i2c_address, TwoWire *wire,
+                                 const VCNL4040_Calibration *calibration) {
+  // the device and registers are part of this object, so begin can be called
+  // again, e.g. after a bus recovery, without allocating anything
+  _i2c_dev = Adafruit_I2CDevice(i2c_address, wire);
+
+  if (!_i2c_dev.begin()) {
+    return false;
+  }
 
-  if (!i2c_dev->begin()) {
+  if (!_init(config)) {
     return false;
   }
 
-  return _init();
+  // blank or corrupt storage, e.g. on first boot, is skipped rather than
+  // failing begin since the sensor is already configured
+  if (calibration && calibrationValid(calibration)) {
+    return applyCalibration(calibration);
+  }
+  return true;
 }
 
-boolean Adafruit_VCNL4040::_init(void) {
-  Adafruit_BusIO_Register chip_id =
-      Adafruit_BusIO_Register(i2c_dev, VCNL4040_DEVICE_ID, 2);
+boolean Adafruit_VCNL4040::_init(const VCNL4040_Config &config) {
+  uint16_t chip_id = 0;
 
   // make sure we're talking to the right chip
-  if (chip_id.read() != 0x0186) {
+  if (!_readRegister(VCNL4040_DEVICE_ID, &chip_id) || chip_id != 0x0186) {
     return false;
   }
 
-  ALS_CONFIG = new Adafruit_BusIO_Register(i2c_dev, VCNL4040_ALS_CONFIG, 2);
-  PS_CONFIG_12 = new Adafruit_BusIO_Register(i2c_dev, VCNL4040_PS_CONF1_L, 2);
-  PS_MS = new Adafruit_BusIO_Register(i2c_dev, VCNL4040_PS_MS_H, 2);
-
-  enableProximity(true);
-  enableWhiteLight(true);
-  enableAmbientLight(true);
-  setProximityHighResolution(true);
-
-  return true;
+  return applyConfig(config);
 }
 /**************** Sensor Data Getters *************************************/
 /**************************************************************************/
@@ -88,10 +166,17 @@ boolean Adafruit_VCNL4040::_init(void) {
 */
 /**************************************************************************/
 uint16_t Adafruit_VCNL4040::getProximity(void) {
-  Adafruit_BusIO_Register proximity =
-      Adafruit_BusIO_Register(i2c_dev, VCNL4040_PS_DATA, 2);
-  delay(10);
-  return (int16_t)proximity.read();
+  uint16_t proximity = 0;
+
+  if (_cachedReading(0, &proximity)) {
+    return proximity;
+  }
+  bool ok = _readRegister(VCNL4040_PS_DATA, &proximity);
+  _resetProximityReady();
+  if (ok) {
+    _storeReading(0, proximity);
+  }
+  return proximity;
 }
 
 /**************************************************************************/
@@ -101,9 +186,9 @@ uint16_t Adafruit_VCNL4040::getProximity(void) {
 */
 /**************************************************************************/
 uint16_t Adafruit_VCNL4040::getAmbientLight(void) {
-  Adafruit_BusIO_Register ambient_light =
-      Adafruit_BusIO_Register(i2c_dev, VCNL4040_ALS_DATA, 2);
-  return (int16_t)ambient_light.read();
+  VCNL4040_AmbientIntegration integration_time;
+
+  return _readLight(1, &integration_time);
 }
 /**************************************************************************/
 /*!
@@ -112,14 +197,20 @@ uint16_t Adafruit_VCNL4040::getAmbientLight(void) {
 */
 /**************************************************************************/
 uint16_t Adafruit_VCNL4040::getWhiteLight(void) {
-  Adafruit_BusIO_Register white_light =
-      Adafruit_BusIO_Register(i2c_dev, VCNL4040_WHITE_DATA, 2);
-  delay(10);
+  return getWhiteLightMilli() / 1000;
+}
 
-  // scale the light depending on the value of the integration time
-  // see page 8 of the VCNL4040 application note:
-  // https://www.vishay.com/docs/84307/designingvcnl4040.pdf
-  return (white_light.read() * (0.1 / (1 << getAmbientIntegrationTime())));
+/**************************************************************************/
+/*!
+    @brief Gets the current white light value at full resolution.
+    @return The current white light measurement in thousandths of a unit
+*/
+/**************************************************************************/
+uint32_t Adafruit_VCNL4040::getWhiteLightMilli(void) {
+  VCNL4040_AmbientIntegration integration_time;
+  uint16_t white_light = _readLight(2, &integration_time);
+
+  return countsToMilliLux(white_light, integration_time);
 }
 
 /**************************************************************************/
@@ -128,14 +219,276 @@ uint16_t Adafruit_VCNL4040::getWhiteLight(void) {
     @return The current ambient light measurement in Lux
 */
 /**************************************************************************/
-uint16_t Adafruit_VCNL4040::getLux(void) {
-  Adafruit_BusIO_Register ambient_light =
-      Adafruit_BusIO_Register(i2c_dev, VCNL4040_ALS_DATA, 2);
-  // scale the lux depending on the value of the integration time
+uint16_t Adafruit_VCNL4040::getLux(void) { return getMilliLux() / 1000; }
+
+/**************************************************************************/
+/*!
+    @brief Gets the current ambient light sensor in thousandths of a Lux,
+           keeping the resolution of the longer integration times.
+    @return The current ambient light measurement in millilux
+*/
+/**************************************************************************/
+uint32_t Adafruit_VCNL4040::getMilliLux(void) {
+  VCNL4040_AmbientIntegration integration_time;
+  uint16_t ambient_light = _readLight(1, &integration_time);
+
+  return countsToMilliLux(ambient_light, integration_time);
+}
+
+/**************************************************************************/
+/*!
+    @brief Reads the ambient or white light. While the sensor is settling
+           after a change of integration time the data registers may still
+           hold a reading from the old integration time, so the bus isn't
+           touched and the last reading taken before the change is returned.
+    @param  index
+            The reading: 1 for ambient, 2 for white light
+    @param  integration_time
+            Where to store the integration time the reading was taken at
+    @return The raw reading, or 0 if the read failed
+*/
+/**************************************************************************/
+uint16_t
+Adafruit_VCNL4040::_readLight(uint8_t index,
+                              VCNL4040_AmbientIntegration *integration_time) {
+  uint16_t counts = 0;
+
+  if (ambientSettling()) {
+    _last_transaction_ok = true;
+    *integration_time =
+        (VCNL4040_AmbientIntegration)_light_integration[index - 1];
+    return _readings[index];
+  }
+  *integration_time = getAmbientIntegrationTime();
+  if (_cachedReading(index, &counts)) {
+    return counts;
+  }
+  bool ok = _readRegister(index == 1 ? VCNL4040_ALS_DATA : VCNL4040_WHITE_DATA,
+                          &counts);
+  _resetLightReady(index);
+  if (ok) {
+    _storeReading(index, counts);
+  }
+  return counts;
+}
+
+/**************************************************************************/
+/*!
+    @brief Converts a raw ambient or white light measurement to millilux
+           using integer arithmetic only.
+    @param  counts
+            The raw measurement
+    @param  integration_time
+            The ambient light integration time the measurement was taken at
+    @return The measurement in thousandths of a Lux
+*/
+/**************************************************************************/
+uint32_t Adafruit_VCNL4040::countsToMilliLux(
+    uint16_t counts, VCNL4040_AmbientIntegration integration_time) {
+  // scale the lux depending on the value of the integration time; 0.1 lux
+  // per count at 80ms, halving with each doubling of the integration time
   // see page 8 of the VCNL4040 application note:
   // https://www.vishay.com/docs/84307/designingvcnl4040.pdf
-  return (ambient_light.read() * (0.1 / (1 << getAmbientIntegrationTime())));
+  return ((uint32_t)counts * 100) >> integration_time;
+}
+
+/**************************************************************************/
+/*!
+    @brief Reads the proximity, ambient light and white light measurements,
+           and optionally the interrupt status, as one sample.
+    @param  sample
+            The `VCNL4040_Sample` to fill with the readings
+    @param  read_interrupt_status
+            Set to true to also read, and so clear, the interrupt status
+    @return True if all of the readings were successful
+
+    The sensor does not auto-increment between its data registers, so each
+    reading is a single write-then-read transaction issued back to back with
+    the others. This keeps the ambient and white light readings from the same
+    conversion. The sample's `flags` report which channels had completed a
+    new conversion since they were last read. While the ambient light sensor
+    is settling after `requestAmbientIntegrationTime` the ambient and white
+    light readings are skipped and reported as settling.
+*/
+/**************************************************************************/
+bool Adafruit_VCNL4040::readAll(VCNL4040_Sample *sample,
+                                bool read_interrupt_status) {
+  return _readSample(sample, read_interrupt_status, false);
+}
+
+/**************************************************************************/
+/*!
+    @brief Reads only the measurements that are fresh, as reported by
+           `proximityDataReady` and `ambientDataReady`, and optionally the
+           interrupt status, as one sample. Channels that are not fresh are
+           filled in with the last reading taken, so polling many sensors
+           only costs a transaction per new measurement.
+    @param  sample
+            The `VCNL4040_Sample` to fill with the readings
+    @param  read_interrupt_status
+            Set to true to also read, and so clear, the interrupt status
+    @return True if all of the readings taken were successful
+*/
+/**************************************************************************/
+bool Adafruit_VCNL4040::readFresh(VCNL4040_Sample *sample,
+                                  bool read_interrupt_status) {
+  return _readSample(sample, read_interrupt_status, true);
+}
+
+/**************************************************************************/
+/*!
+    @brief Reads a sample for `readAll` or `readFresh`
+    @param  sample
+            The `VCNL4040_Sample` to fill with the readings
+    @param  read_interrupt_status
+            Set to true to also read, and so clear, the interrupt status
+    @param  fresh_only
+            Set to true to read only the channels with fresh measurements
+    @return True if all of the readings taken were successful
+*/
+/**************************************************************************/
+bool Adafruit_VCNL4040::_readSample(VCNL4040_Sample *sample,
+                                    bool read_interrupt_status,
+                                    bool fresh_only) {
+  uint16_t interrupt_status = 0;
+
+  sample->timestamp = millis();
+  sample->flags = 0;
+  sample->ambient_integration = getAmbientIntegrationTime();
+  // taken before listeners such as the governor can change it
+  sample->proximity_config = getProximityConfig();
+  if (proximityDataReady()) {
+    sample->flags |= VCNL4040_SAMPLE_PROXIMITY_FRESH;
+  }
+  if (ambientDataReady()) {
+    sample->flags |= VCNL4040_SAMPLE_AMBIENT_FRESH;
+  }
+  bool read_proximity =
+      !fresh_only || (sample->flags & VCNL4040_SAMPLE_PROXIMITY_FRESH);
+  bool read_light =
+      !fresh_only || (sample->flags & VCNL4040_SAMPLE_AMBIENT_FRESH);
+
+  uint8_t registers[VCNL4040_MAX_REGISTER_READS];
+  uint16_t *destinations[VCNL4040_MAX_REGISTER_READS];
+  uint16_t values[VCNL4040_MAX_REGISTER_READS];
+  uint8_t count = 0;
+
+  if (read_proximity) {
+    registers[count] = VCNL4040_PS_DATA;
+    destinations[count++] = &sample->proximity;
+  } else {
+    sample->proximity = _readings[0];
+  }
+  if (ambientSettling()) {
+    // the ALS data registers still hold a reading from the old integration
+    // time, so don't report it
+    sample->flags |= VCNL4040_SAMPLE_AMBIENT_SETTLING;
+    sample->ambient = 0;
+    sample->white = 0;
+  } else if (!read_light) {
+    sample->ambient = _readings[1];
+    sample->white = _readings[2];
+    sample->ambient_integration = _light_integration[0];
+  } else {
+    registers[count] = VCNL4040_ALS_DATA;
+    destinations[count++] = &sample->ambient;
+    registers[count] = VCNL4040_WHITE_DATA;
+    destinations[count++] = &sample->white;
+  }
+  if (read_interrupt_status) {
+    registers[count] = VCNL4040_INT_FLAG;
+    destinations[count++] = &interrupt_status;
+  }
+  if (!_readRegisters(registers, values, count)) {
+    return false;
+  }
+  for (uint8_t i = 0; i < count; i++) {
+    *destinations[i] = values[i];
+  }
+  sample->interrupt_status = interrupt_status >> 8;
+  if (read_proximity) {
+    _resetProximityReady();
+    _storeReading(0, sample->proximity);
+  }
+  if (read_light) {
+    _resetAmbientReady();
+  }
+  if (read_light && !(sample->flags & VCNL4040_SAMPLE_AMBIENT_SETTLING)) {
+    // stored first, so they keep the integration time they were taken at
+    _storeReading(1, sample->ambient);
+    _storeReading(2, sample->white);
+    _autoRange(sample->ambient);
+  }
+
+  _notifySampleListeners(sample);
+  return true;
 }
+
+/**************************************************************************/
+/*!
+    @brief Adds a listener to be passed every sample read by `readAll`
+    @param  listener
+            The listener to add. It must stay in scope until removed.
+*/
+/**************************************************************************/
+void Adafruit_VCNL4040::addSampleListener(VCNL4040_SampleListener *listener) {
+  removeSampleListener(listener);
+  listener->_next_listener = _sample_listeners;
+  _sample_listeners = listener;
+}
+
+/**************************************************************************/
+/*!
+    @brief Removes a listener added with `addSampleListener`
+    @param  listener
+            The listener to remove
+*/
+/**************************************************************************/
+void Adafruit_VCNL4040::removeSampleListener(
+    VCNL4040_SampleListener *listener) {
+  for (VCNL4040_SampleListener **link = &_sample_listeners; *link;
+       link = &(*link)->_next_listener) {
+    if (*link == listener) {
+      *link = listener->_next_listener;
+      listener->_next_listener = NULL;
+      return;
+    }
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Passes a previously recorded sample to the sample listeners as if
+           it had just been read, so recordings can be run through the same
+           filters and detectors as live data. The sample is marked with
+           `VCNL4040_SAMPLE_REPLAYED`. This doesn't touch the bus, but
+           listeners may: `Adafruit_VCNL4040_Governor` ignores replayed
+           samples for that reason.
+    @param  sample
+            The sample to replay
+*/
+/**************************************************************************/
+void Adafruit_VCNL4040::replaySample(const VCNL4040_Sample *sample) {
+  VCNL4040_Sample replayed = *sample;
+
+  replayed.flags |= VCNL4040_SAMPLE_REPLAYED;
+  _notifySampleListeners(&replayed);
+}
+
+/**************************************************************************/
+/*!
+    @brief Passes a sample to every listener added with `addSampleListener`
+    @param  sample
+            The sample to pass on
+*/
+/**************************************************************************/
+void Adafruit_VCNL4040::_notifySampleListeners(const VCNL4040_Sample *sample) {
+  for (VCNL4040_SampleListener *listener = _sample_listeners; listener;
+       listener = listener->_next_listener) {
+    listener->onSample(sample);
+  }
+}
+
 /**************** Sensor Enable Functions   *******************************/
 
 /**************************************************************************/
@@ -146,9 +499,8 @@ uint16_t Adafruit_VCNL4040::getLux(void) {
             set to false to disable.
 */
 void Adafruit_VCNL4040::enableProximity(bool enable) {
-  Adafruit_BusIO_RegisterBits ps_disable =
-      Adafruit_BusIO_RegisterBits(PS_CONFIG_12, 1, 0);
-  ps_disable.write(!enable);
+  _writeConfigBits(VCNL4040_PS_CONF1_L, &_ps_config_12, 1, 0, !enable);
+  _resetProximityReady();
 }
 /**************************************************************************/
 /*!
@@ -158,9 +510,8 @@ void Adafruit_VCNL4040::enableProximity(bool enable) {
             set to false to disable.
 */
 void Adafruit_VCNL4040::enableAmbientLight(bool enable) {
-  Adafruit_BusIO_RegisterBits als_disable =
-      Adafruit_BusIO_RegisterBits(ALS_CONFIG, 1, 0);
-  als_disable.write(!enable);
+  _writeConfigBits(VCNL4040_ALS_CONFIG, &_als_config, 1, 0, !enable);
+  _resetAmbientReady();
 }
 /**************************************************************************/
 /*!
@@ -170,9 +521,7 @@ void Adafruit_VCNL4040::enableAmbientLight(bool enable) {
             set to false to disable.
 */
 void Adafruit_VCNL4040::enableWhiteLight(bool enable) {
-  Adafruit_BusIO_RegisterBits white_disable =
-      Adafruit_BusIO_RegisterBits(PS_MS, 1, 15);
-  white_disable.write(!enable);
+  _writeConfigBits(VCNL4040_PS_MS_H, &_ps_ms, 1, 15, !enable);
 }
 
 /*************************** Interrupt Functions  *********************** */
@@ -187,12 +536,156 @@ void Adafruit_VCNL4040::enableWhiteLight(bool enable) {
 */
 /**************************************************************************/
 uint8_t Adafruit_VCNL4040::getInterruptStatus(void) {
-  Adafruit_BusIO_Register interrupt_status_register =
-      Adafruit_BusIO_Register(i2c_dev, VCNL4040_INT_FLAG, 2);
+  uint16_t interrupt_status = 0;
+
+  _readRegister(VCNL4040_INT_FLAG, &interrupt_status);
+  return interrupt_status >> 8;
+}
+
+/**************************************************************************/
+/*!
+    @brief Attaches an interrupt handler to the pin connected to the sensor's
+           INT output, so `serviceInterrupts` only touches the bus after the
+           sensor has raised an interrupt. Only one sensor at a time can be
+           attached this way; for others call `handleInterrupt` from your own
+           interrupt handler.
+    @param  pin
+            The pin connected to the sensor's INT output
+*/
+/**************************************************************************/
+void Adafruit_VCNL4040::attachInterruptPin(uint8_t pin) {
+  if (interrupt_instance) {
+    interrupt_instance->detachInterruptPin();
+  }
+  interrupt_instance = this;
+  _interrupt_pin = pin;
+  // INT is open drain and active low
+  pinMode(pin, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(pin), _interruptHandler, FALLING);
+  // catch an interrupt that was asserted before the handler was attached
+  _interrupt_pending = true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Detaches the interrupt handler attached by `attachInterruptPin`.
+           `serviceInterrupts` goes back to reading the interrupt status on
+           every call.
+*/
+/**************************************************************************/
+void Adafruit_VCNL4040::detachInterruptPin(void) {
+  if (_interrupt_pin < 0) {
+    return;
+  }
+  detachInterrupt(digitalPinToInterrupt(_interrupt_pin));
+  _interrupt_pin = -1;
+  if (interrupt_instance == this) {
+    interrupt_instance = NULL;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Registers a callback to be run by `serviceInterrupts` when an
+           interrupt event occurs.
+    @param  event
+            The `VCNL4040_InterruptType` to handle
+    @param  callback
+            The function to call, or NULL to remove the callback
+*/
+/**************************************************************************/
+void Adafruit_VCNL4040::onInterrupt(VCNL4040_InterruptType event,
+                                    VCNL4040_InterruptCallback callback) {
+  for (uint8_t i = 0; i < sizeof(interrupt_types); i++) {
+    if (interrupt_types[i] == event) {
+      _interrupt_callbacks[i] = callback;
+    }
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Sets whether `serviceInterrupts` reads the sensor data along with
+           the interrupt status and passes it to the callbacks.
+    @param  capture
+            Set to true to pass a sample to callbacks, false to pass NULL
+*/
+/**************************************************************************/
+void Adafruit_VCNL4040::captureInterruptSamples(bool capture) {
+  _capture_interrupt_samples = capture;
+}
+
+/**************************************************************************/
+/*!
+    @brief Reads and clears the interrupt status and runs the callbacks
+           registered for each event that occurred. When an INT pin is
+           attached the bus is only accessed after the pin has been asserted.
+           Call from `loop()`, not from an interrupt handler.
+    @return The interrupt status that was handled, or 0 if none
+*/
+/**************************************************************************/
+uint8_t Adafruit_VCNL4040::serviceInterrupts(void) {
+  VCNL4040_Sample sample;
+  uint16_t interrupt_status;
+
+  if (_interrupt_pin >= 0 && !_interrupt_pending) {
+    return 0;
+  }
+  // cleared before reading so an edge during the read isn't lost
+  _interrupt_pending = false;
+
+  if (_capture_interrupt_samples) {
+    if (!readAll(&sample, true)) {
+      // INT stays asserted until INT_FLAG is read, so there won't be
+      // another edge; try again on the next call
+      _interrupt_pending = true;
+      return 0;
+    }
+    interrupt_status = sample.interrupt_status;
+  } else {
+    if (!_readRegister(VCNL4040_INT_FLAG, &interrupt_status)) {
+      _interrupt_pending = true;
+      return 0;
+    }
+    interrupt_status >>= 8;
+  }
+
+  if (_als_change_detection &&
+      (interrupt_status & (VCNL4040_AMBIENT_HIGH | VCNL4040_AMBIENT_LOW))) {
+    uint16_t counts;
+    bool have_counts;
+
+    if (_capture_interrupt_samples &&
+        !(sample.flags & VCNL4040_SAMPLE_AMBIENT_SETTLING)) {
+      counts = sample.ambient;
+      have_counts = true;
+    } else {
+      have_counts = _readRegister(VCNL4040_ALS_DATA, &counts);
+    }
+    // without a reading the window stays where it is; the sensor interrupts
+    // again and the next call retries
+    if (have_counts) {
+      rearmAmbientWindow(counts);
+    }
+  }
+
+  for (uint8_t i = 0; i < sizeof(interrupt_types); i++) {
+    if ((interrupt_status & interrupt_types[i]) && _interrupt_callbacks[i]) {
+      _interrupt_callbacks[i](
+          (VCNL4040_InterruptType)interrupt_types[i],
+          _capture_interrupt_samples ? &sample : NULL);
+    }
+  }
+  return interrupt_status;
+}
 
-  Adafruit_BusIO_RegisterBits interrupt_status =
-      Adafruit_BusIO_RegisterBits(&interrupt_status_register, 8, 8);
-  return (uint16_t)interrupt_status.read();
+/*!
+    @brief Interrupt handler attached by `attachInterruptPin`
+*/
+void VCNL4040_ISR_ATTR Adafruit_VCNL4040::_interruptHandler(void) {
+  if (interrupt_instance) {
+    interrupt_instance->handleInterrupt();
+  }
 }
 
 /********************* Ambient Light Interrupt Functions **************** */
@@ -205,9 +698,7 @@ uint8_t Adafruit_VCNL4040::getInterruptStatus(void) {
 */
 /**************************************************************************/
 void Adafruit_VCNL4040::enableAmbientLightInterrupts(bool enable) {
-  Adafruit_BusIO_RegisterBits als_interrupt_enable =
-      Adafruit_BusIO_RegisterBits(ALS_CONFIG, 1, 1);
-  als_interrupt_enable.write(enable);
+  _writeConfigBits(VCNL4040_ALS_CONFIG, &_als_config, 1, 1, enable);
 }
 
 /**************************************************************************/
@@ -217,9 +708,10 @@ void Adafruit_VCNL4040::enableAmbientLightInterrupts(bool enable) {
 */
 /**************************************************************************/
 uint16_t Adafruit_VCNL4040::getAmbientLightHighThreshold(void) {
-  Adafruit_BusIO_Register als_high_threshold =
-      Adafruit_BusIO_Register(i2c_dev, VCNL4040_ALS_THDH, 2);
-  return (uint16_t)als_high_threshold.read();
+  uint16_t als_high_threshold = 0;
+
+  _readRegister(VCNL4040_ALS_THDH, &als_high_threshold);
+  return als_high_threshold;
 }
 /**************************************************************************/
 /*!
@@ -229,9 +721,10 @@ uint16_t Adafruit_VCNL4040::getAmbientLightHighThreshold(void) {
 */
 /**************************************************************************/
 void Adafruit_VCNL4040::setAmbientLightHighThreshold(uint16_t high_threshold) {
-  Adafruit_BusIO_Register als_high_threshold =
-      Adafruit_BusIO_Register(i2c_dev, VCNL4040_ALS_THDH, 2);
-  als_high_threshold.write(high_threshold);
+  if (_writeRegister(VCNL4040_ALS_THDH, high_threshold)) {
+    _als_thdh = high_threshold;
+    _als_thresholds_known |= 1 << 1;
+  }
 }
 /**************************************************************************/
 /*!
@@ -240,9 +733,10 @@ void Adafruit_VCNL4040::setAmbientLightHighThreshold(uint16_t high_threshold) {
 */
 /**************************************************************************/
 uint16_t Adafruit_VCNL4040::getAmbientLightLowThreshold(void) {
-  Adafruit_BusIO_Register als_low_threshold =
-      Adafruit_BusIO_Register(i2c_dev, VCNL4040_ALS_THDL, 2);
-  return (uint16_t)als_low_threshold.read();
+  uint16_t als_low_threshold = 0;
+
+  _readRegister(VCNL4040_ALS_THDL, &als_low_threshold);
+  return als_low_threshold;
 }
 
 /**************************************************************************/
@@ -253,9 +747,88 @@ uint16_t Adafruit_VCNL4040::getAmbientLightLowThreshold(void) {
 */
 /**************************************************************************/
 void Adafruit_VCNL4040::setAmbientLightLowThreshold(uint16_t low_threshold) {
-  Adafruit_BusIO_Register als_low_threshold =
-      Adafruit_BusIO_Register(i2c_dev, VCNL4040_ALS_THDL, 2);
-  als_low_threshold.write(low_threshold);
+  if (_writeRegister(VCNL4040_ALS_THDL, low_threshold)) {
+    _als_thdl = low_threshold;
+    _als_thresholds_known |= 1;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Enables or disables ambient light change detection. When enabled
+           the ambient light thresholds are set to a window around the
+           current reading and ambient light interrupts are enabled, so the
+           sensor only interrupts once the light has changed by more than the
+           window set with `setAmbientChangeWindow`. `serviceInterrupts`
+           moves the window to the new reading after each change.
+    @param  enable
+            Set to true to enable change detection, false to disable
+    @return True if the sensor was configured successfully
+*/
+/**************************************************************************/
+bool Adafruit_VCNL4040::enableAmbientChangeDetection(bool enable) {
+  uint16_t counts;
+
+  _als_change_detection = enable;
+  if (enable && (!_readRegister(VCNL4040_ALS_DATA, &counts) ||
+                 !rearmAmbientWindow(counts))) {
+    return false;
+  }
+  return _writeConfigBits(VCNL4040_ALS_CONFIG, &_als_config, 1, 1, enable);
+}
+
+/**************************************************************************/
+/*!
+    @brief Sets how far the ambient light must change from the last reading
+           before change detection raises an interrupt.
+    @param  window
+            The change in raw counts, or in percent if `percent` is true
+    @param  percent
+            Set to true to treat `window` as a percentage of the reading
+    @param  min_counts
+            The smallest window in raw counts when `window` is a percentage,
+            so that in dim light the window doesn't shrink to within the
+            sensor's noise and interrupt on nearly every measurement
+*/
+/**************************************************************************/
+void Adafruit_VCNL4040::setAmbientChangeWindow(uint16_t window, bool percent,
+                                               uint16_t min_counts) {
+  _als_change_window = window;
+  _als_change_percent = percent;
+  _als_change_min_window = min_counts;
+}
+
+/**************************************************************************/
+/*!
+    @brief Sets the ambient light thresholds to the change detection window
+           around a reading. Thresholds that already hold the right value
+           are not rewritten, so at most two writes are needed.
+    @param  counts
+            The raw ambient light reading to centre the window on
+    @return True if the thresholds were written successfully
+*/
+/**************************************************************************/
+bool Adafruit_VCNL4040::rearmAmbientWindow(uint16_t counts) {
+  uint32_t window = _als_change_window;
+  uint16_t low, high;
+
+  if (_als_change_percent) {
+    window = ((uint32_t)counts * window) / 100;
+    if (window < _als_change_min_window) {
+      window = _als_change_min_window;
+    }
+  }
+  low = (counts > window) ? counts - window : 0;
+  high = ((uint32_t)counts + window < 0xFFFF) ? counts + window : 0xFFFF;
+
+  if (!(_als_thresholds_known & 1) || low != _als_thdl) {
+    setAmbientLightLowThreshold(low);
+  }
+  if (!(_als_thresholds_known & (1 << 1)) || high != _als_thdh) {
+    setAmbientLightHighThreshold(high);
+  }
+  return (_als_thresholds_known == 0x3) && (low == _als_thdl) &&
+         (high == _als_thdh);
 }
 
 /********************* Proximity Interrupt Functions **************** */
@@ -271,10 +844,8 @@ void Adafruit_VCNL4040::setAmbientLightLowThreshold(uint16_t low_threshold) {
 /**************************************************************************/
 void Adafruit_VCNL4040::enableProximityInterrupts(
     VCNL4040_ProximityType interrupt_condition) {
-  Adafruit_BusIO_RegisterBits proximity_int_config =
-      Adafruit_BusIO_RegisterBits(PS_CONFIG_12, 2, 8);
-
-  proximity_int_config.write(interrupt_condition);
+  _writeConfigBits(VCNL4040_PS_CONF1_L, &_ps_config_12, 2, 8,
+                   interrupt_condition);
 }
 
 /**************************************************************************/
@@ -284,10 +855,10 @@ void Adafruit_VCNL4040::enableProximityInterrupts(
 */
 /**************************************************************************/
 uint16_t Adafruit_VCNL4040::getProximityLowThreshold(void) {
-  Adafruit_BusIO_Register proximity_low_threshold =
-      Adafruit_BusIO_Register(i2c_dev, VCNL4040_PS_THDL, 2);
+  uint16_t proximity_low_threshold = 0;
 
-  return (uint16_t)proximity_low_threshold.read();
+  _readRegister(VCNL4040_PS_THDL, &proximity_low_threshold);
+  return proximity_low_threshold;
 }
 /**************************************************************************/
 /*!
@@ -297,10 +868,7 @@ uint16_t Adafruit_VCNL4040::getProximityLowThreshold(void) {
 */
 /**************************************************************************/
 void Adafruit_VCNL4040::setProximityLowThreshold(uint16_t low_threshold) {
-  Adafruit_BusIO_Register proximity_low_threshold =
-      Adafruit_BusIO_Register(i2c_dev, VCNL4040_PS_THDL, 2);
-
-  proximity_low_threshold.write(low_threshold);
+  _writeRegister(VCNL4040_PS_THDL, low_threshold);
 }
 /**************************************************************************/
 /*!
@@ -309,10 +877,10 @@ void Adafruit_VCNL4040::setProximityLowThreshold(uint16_t low_threshold) {
 */
 /**************************************************************************/
 uint16_t Adafruit_VCNL4040::getProximityHighThreshold(void) {
-  Adafruit_BusIO_Register proximity_high_threshold =
-      Adafruit_BusIO_Register(i2c_dev, VCNL4040_PS_THDH, 2);
+  uint16_t proximity_high_threshold = 0;
 
-  return (uint16_t)proximity_high_threshold.read();
+  _readRegister(VCNL4040_PS_THDH, &proximity_high_threshold);
+  return proximity_high_threshold;
 }
 /**************************************************************************/
 /*!
@@ -322,95 +890,520 @@ uint16_t Adafruit_VCNL4040::getProximityHighThreshold(void) {
 */
 /**************************************************************************/
 void Adafruit_VCNL4040::setProximityHighThreshold(uint16_t high_threshold) {
-  Adafruit_BusIO_Register proximity_high_threshold =
-      Adafruit_BusIO_Register(i2c_dev, VCNL4040_PS_THDH, 2);
-
-  proximity_high_threshold.write(high_threshold);
+  _writeRegister(VCNL4040_PS_THDH, high_threshold);
 }
 
-/******************** Tuning Functions ********************************** */
+/**************************************************************************/
+/*!
+    @brief Gets the proximity cancellation level, which is subtracted from
+           each proximity measurement to remove crosstalk.
+    @returns  The current cancellation level
+*/
+/**************************************************************************/
+uint16_t Adafruit_VCNL4040::getProximityCancellation(void) {
+  uint16_t proximity_cancellation = 0;
 
+  _readRegister(VCNL4040_PS_CANC, &proximity_cancellation);
+  return proximity_cancellation;
+}
 /**************************************************************************/
 /*!
-    @brief Gets the integration time for proximity sensing measurements.
-    @returns The integration time being used for proximity measurements.
+    @brief Sets the proximity cancellation level, which is subtracted from
+           each proximity measurement to remove crosstalk.
+    @param  cancellation
+            The cancellation level to set
 */
-VCNL4040_ProximityIntegration
-Adafruit_VCNL4040::getProximityIntegrationTime(void) {
-  Adafruit_BusIO_RegisterBits proximity_int_config =
-      Adafruit_BusIO_RegisterBits(PS_CONFIG_12, 3, 1);
-  delay(50);
-  return (VCNL4040_ProximityIntegration)proximity_int_config.read();
+/**************************************************************************/
+void Adafruit_VCNL4040::setProximityCancellation(uint16_t cancellation) {
+  _writeRegister(VCNL4040_PS_CANC, cancellation);
 }
+
+/******************** Proximity Calibration Functions ******************* */
+
 /**************************************************************************/
 /*!
-    @brief Sets the integration time for proximity sensing measurements.
-    @param  integration_time
-            The integration time to use for proximity measurements. Must be a
-            `VCNL4040_ProximityIntegration`.
+    @brief Measures and cancels the proximity crosstalk, for example from
+           cover glass, and derives proximity thresholds from the remaining
+           noise. Nothing should be in front of the sensor. Blocks for
+           `samples` proximity measurement periods; see
+           `requestProximityCalibration` to calibrate without blocking.
+    @param  calibration
+            Where to store the calibration, which can be saved and later
+            passed to `begin` or `applyCalibration`
+    @param  samples
+            The number of proximity measurements to average
+    @param  margin
+            How far above the noise the low threshold is set; the high
+            threshold is set twice as far above it
+    @return True if the calibration was measured and applied successfully
 */
-void Adafruit_VCNL4040::setProximityIntegrationTime(
-    VCNL4040_ProximityIntegration integration_time) {
-  Adafruit_BusIO_RegisterBits proximity_int_config =
-      Adafruit_BusIO_RegisterBits(PS_CONFIG_12, 3, 1);
-  delay(50);
-  proximity_int_config.write(integration_time);
+/**************************************************************************/
+bool Adafruit_VCNL4040::calibrateProximity(VCNL4040_Calibration *calibration,
+                                           uint8_t samples, uint16_t margin) {
+  if (!requestProximityCalibration(calibration, samples, margin)) {
+    return false;
+  }
+  while (_operation == VCNL4040_OPERATION_CALIBRATION) {
+    delay(1);
+    tick(millis());
+  }
+  return _operation_status == VCNL4040_STATUS_DONE;
 }
 
 /**************************************************************************/
 /*!
-    @brief Gets the integration time for ambient light sensing measurements.
-    @returns The integration time being used for ambient light measurements.
+    @brief Starts a proximity calibration like `calibrateProximity` without
+           blocking. Each call to `tick` takes a reading once one is ready,
+           and the calibration is applied after the last.
+    @param  calibration
+            Where to store the calibration. It must stay in scope until the
+            calibration has finished.
+    @param  samples
+            The number of proximity measurements to average
+    @param  margin
+            How far above the noise the low threshold is set; the high
+            threshold is set twice as far above it
+    @return True if the calibration was started, false if another is
+            running or the cancellation couldn't be cleared
 */
-VCNL4040_AmbientIntegration Adafruit_VCNL4040::getAmbientIntegrationTime(void) {
-  Adafruit_BusIO_RegisterBits ambient_int_config =
-      Adafruit_BusIO_RegisterBits(ALS_CONFIG, 2, 6);
-  delay(50);
-  return (VCNL4040_AmbientIntegration)ambient_int_config.read();
+/**************************************************************************/
+bool Adafruit_VCNL4040::requestProximityCalibration(
+    VCNL4040_Calibration *calibration, uint8_t samples, uint16_t margin) {
+  if (!samples || _operation == VCNL4040_OPERATION_CALIBRATION ||
+      !_writeRegister(VCNL4040_PS_CANC, 0)) {
+    return false;
+  }
+  // measurements taken before the cancellation was cleared don't count
+  _resetProximityReady();
+
+  _calibration = calibration;
+  _calibration_sum = 0;
+  _calibration_max = 0;
+  _calibration_margin = margin;
+  _calibration_samples = samples;
+  _calibration_count = 0;
+  _operation = VCNL4040_OPERATION_CALIBRATION;
+  _operation_status = VCNL4040_STATUS_BUSY;
+  return true;
 }
 
 /**************************************************************************/
 /*!
-    @brief Sets the integration time for ambient light sensing measurements.
-    @param  integration_time
-            The integration time to use for ambient light measurements. Must be
-   a `VCNL4040_AmbientIntegration`.
+    @brief Computes and applies a calibration from the readings taken by
+           `tick`
+    @return True if the calibration was applied successfully
 */
-void Adafruit_VCNL4040::setAmbientIntegrationTime(
-    VCNL4040_AmbientIntegration integration_time) {
-  Adafruit_BusIO_RegisterBits ambient_int_config =
-      Adafruit_BusIO_RegisterBits(ALS_CONFIG, 2, 6);
+/**************************************************************************/
+bool Adafruit_VCNL4040::_finishCalibration(void) {
+  uint32_t low_threshold, high_threshold;
+  uint16_t average = _calibration_sum / _calibration_samples;
+  uint16_t noise = _calibration_max - average;
 
-  // delay according to the integration time to let the reading at the old IT
-  // clear out
-  uint16_t old_it_ms = ((8 << ambient_int_config.read()) * 10);
-  uint16_t new_it_ms = ((8 << integration_time) * 10);
+  low_threshold = (uint32_t)noise + _calibration_margin;
+  high_threshold = low_threshold + _calibration_margin;
 
-  ambient_int_config.write(integration_time);
-  delay((old_it_ms + new_it_ms + 1));
+  _calibration->cancellation = average;
+  _calibration->low_threshold =
+      (low_threshold < 0xFFFF) ? low_threshold : 0xFFFF;
+  _calibration->high_threshold =
+      (high_threshold < 0xFFFF) ? high_threshold : 0xFFFF;
+  _calibration->check = _calibrationCheck(_calibration);
+
+  return applyCalibration(_calibration);
 }
 
 /**************************************************************************/
 /*!
-    @brief Gets the current for the LED used for proximity measurements.
-    @returns The LED current value being used for proximity measurements.
+    @brief Restores a proximity calibration from `calibrateProximity` by
+           writing the cancellation level and thresholds, one write each.
+    @param  calibration
+            The calibration to restore
+    @return True if the calibration was valid and written successfully
 */
-VCNL4040_LEDCurrent Adafruit_VCNL4040::getProximityLEDCurrent(void) {
-  Adafruit_BusIO_RegisterBits led_current_config =
-      Adafruit_BusIO_RegisterBits(PS_MS, 3, 8);
-  return (VCNL4040_LEDCurrent)led_current_config.read();
-} /**************************************************************************/
-/*!
-    @brief Sets the current for the LED used for proximity measurements.
-    @param  led_current
-            The current value to be used for proximity measurements. Must be a
-            `VCNL4040_LEDCurrent`.
+/**************************************************************************/
+bool Adafruit_VCNL4040::applyCalibration(
+    const VCNL4040_Calibration *calibration) {
+  if (!calibrationValid(calibration)) {
+    return false;
+  }
+  return _writeRegister(VCNL4040_PS_CANC, calibration->cancellation) &&
+         _writeRegister(VCNL4040_PS_THDL, calibration->low_threshold) &&
+         _writeRegister(VCNL4040_PS_THDH, calibration->high_threshold);
+}
+
+/**************************************************************************/
+/*!
+    @brief Checks a calibration's check byte, for example to tell whether
+           storage holds a saved calibration or is blank and the sensor
+           needs calibrating
+    @param  calibration
+            The calibration to check
+    @return True if the calibration can be restored
+*/
+/**************************************************************************/
+bool Adafruit_VCNL4040::calibrationValid(
+    const VCNL4040_Calibration *calibration) {
+  return calibration->check == _calibrationCheck(calibration);
+}
+
+/**************************************************************************/
+/*!
+    @brief Computes the check byte of a calibration, so that blank or
+           corrupted storage is not restored
+    @param  calibration
+            The calibration to check
+    @return The expected value of `calibration->check`
+*/
+/**************************************************************************/
+uint8_t
+Adafruit_VCNL4040::_calibrationCheck(const VCNL4040_Calibration *calibration) {
+  const uint16_t fields[] = {calibration->cancellation,
+                             calibration->low_threshold,
+                             calibration->high_threshold};
+  uint8_t check = 0x40;
+
+  for (uint8_t i = 0; i < 3; i++) {
+    check += (fields[i] & 0xFF) + (fields[i] >> 8);
+  }
+  return check;
+}
+
+/******************** Non-blocking Operation Functions ***************** */
+
+/**************************************************************************/
+/*!
+    @brief Advances any running operation without blocking, for use from a
+           cooperative scheduler in place of the blocking calls. Touches the
+           bus only when a calibration reading is ready, and runs the
+           `onOperationComplete` callback when an operation finishes.
+    @param  now_ms
+            The current time from `millis()`
+    @return True while a calibration is running or the ambient light
+            sensor is settling, so `tick` should be called again
+*/
+/**************************************************************************/
+bool Adafruit_VCNL4040::tick(uint32_t now_ms) {
+  if (_als_settle_pending && _ambientSettled(now_ms)) {
+    _als_settle_pending = false;
+    if (_operation_callback) {
+      _operation_callback(VCNL4040_OPERATION_AMBIENT_SETTLE, true);
+    }
+  }
+
+  if (_operation == VCNL4040_OPERATION_CALIBRATION &&
+      getProximityActiveForce() && !_ps_trigger_pending &&
+      !triggerProximity()) {
+    // in active force mode each calibration reading has to be triggered
+    _finishOperation(VCNL4040_OPERATION_CALIBRATION, false);
+  }
+  if (_operation == VCNL4040_OPERATION_CALIBRATION && _dataReady(0, now_ms)) {
+    uint16_t reading;
+
+    if (!_readRegister(VCNL4040_PS_DATA, &reading)) {
+      _finishOperation(VCNL4040_OPERATION_CALIBRATION, false);
+    } else {
+      _resetProximityReady();
+      _calibration_sum += reading;
+      if (reading > _calibration_max) {
+        _calibration_max = reading;
+      }
+      if (++_calibration_count == _calibration_samples) {
+        _finishOperation(VCNL4040_OPERATION_CALIBRATION, _finishCalibration());
+      }
+    }
+  }
+  return _als_settle_pending || _operation != VCNL4040_OPERATION_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief Gets the status of the calibration started last by
+           `requestProximityCalibration` or `calibrateProximity`
+    @return `VCNL4040_STATUS_BUSY` while running, then
+            `VCNL4040_STATUS_DONE` or `VCNL4040_STATUS_FAILED`, or
+            `VCNL4040_STATUS_IDLE` if none has been started
+*/
+/**************************************************************************/
+VCNL4040_OperationStatus Adafruit_VCNL4040::getOperationStatus(void) {
+  return (VCNL4040_OperationStatus)_operation_status;
+}
+
+/**************************************************************************/
+/*!
+    @brief Registers a callback to be run by `tick` when a calibration
+           finishes or the ambient light sensor has settled after
+           `requestAmbientIntegrationTime`
+    @param  callback
+            The function to call, or NULL to remove the callback
+*/
+/**************************************************************************/
+void Adafruit_VCNL4040::onOperationComplete(
+    VCNL4040_OperationCallback callback) {
+  _operation_callback = callback;
+}
+
+/**************************************************************************/
+/*!
+    @brief Ends the running operation and reports its result
+    @param  operation
+            The operation that finished
+    @param  success
+            Whether the operation succeeded
+*/
+/**************************************************************************/
+void Adafruit_VCNL4040::_finishOperation(VCNL4040_Operation operation,
+                                         bool success) {
+  _operation = VCNL4040_OPERATION_NONE;
+  _operation_status = success ? VCNL4040_STATUS_DONE : VCNL4040_STATUS_FAILED;
+  if (_operation_callback) {
+    _operation_callback(operation, success);
+  }
+}
+
+/******************** Tuning Functions ********************************** */
+
+/**************************************************************************/
+/*!
+    @brief Gets the integration time for proximity sensing measurements.
+    @returns The integration time being used for proximity measurements.
+*/
+VCNL4040_ProximityIntegration
+Adafruit_VCNL4040::getProximityIntegrationTime(void) {
+  return (VCNL4040_ProximityIntegration)((_ps_config_12 >> 1) & 0x7);
+}
+/**************************************************************************/
+/*!
+    @brief Sets the integration time for proximity sensing measurements.
+    @param  integration_time
+            The integration time to use for proximity measurements. Must be a
+            `VCNL4040_ProximityIntegration`.
+*/
+void Adafruit_VCNL4040::setProximityIntegrationTime(
+    VCNL4040_ProximityIntegration integration_time) {
+  _writeConfigBits(VCNL4040_PS_CONF1_L, &_ps_config_12, 3, 1, integration_time);
+  _resetProximityReady();
+}
+
+/**************************************************************************/
+/*!
+    @brief Gets the integration time for ambient light sensing measurements.
+    @returns The integration time being used for ambient light measurements.
+*/
+VCNL4040_AmbientIntegration Adafruit_VCNL4040::getAmbientIntegrationTime(void) {
+  return (VCNL4040_AmbientIntegration)((_als_config >> 6) & 0x3);
+}
+
+/**************************************************************************/
+/*!
+    @brief Sets the integration time for ambient light sensing measurements.
+    @param  integration_time
+            The integration time to use for ambient light measurements. Must be
+   a `VCNL4040_AmbientIntegration`.
+
+    Blocks until the sensor has settled; `requestAmbientIntegrationTime`
+    doesn't. Inside a configuration batch this doesn't wait either; the
+    sensor settles after `commitConfigBatch` instead.
+*/
+void Adafruit_VCNL4040::setAmbientIntegrationTime(
+    VCNL4040_AmbientIntegration integration_time) {
+  requestAmbientIntegrationTime(integration_time);
+  if (_config_batch) {
+    // the new integration time isn't written until the batch is committed
+    return;
+  }
+  // delay according to the integration time to let the reading at the old IT
+  // clear out
+  while (ambientSettling()) {
+    delay(1);
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Sets the integration time for ambient light sensing measurements
+           without waiting for the sensor to settle.
+    @param  integration_time
+            The integration time to use for ambient light measurements. Must be
+   a `VCNL4040_AmbientIntegration`.
+    @return True if the new integration time was written successfully
+
+    Ambient and white light readings taken before the sensor has settled may
+    have been measured at the old integration time; `ambientSettling` reports
+    whether that is still the case. Until then the ambient and white light
+    getters return the last reading taken before the change, converted at
+    the integration time it was taken at, and `readAll` flags samples as
+    settling. `tick` runs the `onOperationComplete` callback once the sensor
+    has settled.
+*/
+bool Adafruit_VCNL4040::requestAmbientIntegrationTime(
+    VCNL4040_AmbientIntegration integration_time) {
+  uint16_t old_config = _als_config;
+
+  if (!_writeConfigBits(VCNL4040_ALS_CONFIG, &_als_config, 2, 6,
+                        integration_time)) {
+    return false;
+  }
+  if (!_config_batch) {
+    _startAmbientSettling(old_config);
+  }
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Starts the settling time after the ambient light integration time
+           has been written
+    @param  old_config
+            The value of ALS_CONFIG before the write
+*/
+void Adafruit_VCNL4040::_startAmbientSettling(uint16_t old_config) {
+  // let the reading at the old IT clear out and a new one complete
+  uint16_t old_it_ms = ((8 << ((old_config >> 6) & 0x3)) * 10);
+  uint16_t new_it_ms = ((8 << ((_als_config >> 6) & 0x3)) * 10);
+
+  _als_settle_start_ms = millis();
+  _als_settle_wait_ms = old_it_ms + new_it_ms + 1;
+  _als_settling = true;
+  _als_settle_pending = true;
+  // the first data at the new integration time is due once settled
+  _startWait(1, _als_settle_wait_ms);
+  _startWait(2, _als_settle_wait_ms);
+}
+
+/**************************************************************************/
+/*!
+    @brief Checks whether the ambient light sensor is still settling after
+           a change of integration time.
+    @return True if ambient and white light readings may still be from the
+            previous integration time
+*/
+bool Adafruit_VCNL4040::ambientSettling(void) {
+  return !_ambientSettled(millis());
+}
+
+/*!
+    @brief Checks whether an ALS_IT change has settled, ending the settling
+           time once it is seen to have passed so that its start time is
+           never compared again after the clock wraps
+    @param  now_ms
+            The current time from `millis()`
+    @return True if no integration time change is still settling
+*/
+bool Adafruit_VCNL4040::_ambientSettled(uint32_t now_ms) {
+  if (_als_settling &&
+      (uint32_t)(now_ms - _als_settle_start_ms) >= _als_settle_wait_ms) {
+    _als_settling = false;
+  }
+  return !_als_settling;
+}
+
+/******************** Auto Range Functions ****************************** */
+
+/**************************************************************************/
+/*!
+    @brief Enables or disables automatic selection of the ambient light
+           integration time. When enabled, each ambient light reading taken
+           by `getAutoRangedLux` or `readAll` that is near saturation moves
+           to the next shorter integration time, and each reading too small
+           for useful resolution moves to the next longer one. Changes are
+           made with `requestAmbientIntegrationTime` so nothing blocks.
+    @param  enable
+            Set to true to enable automatic ranging, false to disable
+*/
+void Adafruit_VCNL4040::enableAmbientAutoRange(bool enable) {
+  _als_auto_range = enable;
+}
+
+/**************************************************************************/
+/*!
+    @brief Sets the raw ambient light readings at which automatic ranging
+           changes the integration time. Each step doubles or halves the
+           reading, so `low_counts` should be less than half of
+           `high_counts` to keep the range from oscillating.
+    @param  low_counts
+            Readings below this move to a longer integration time
+    @param  high_counts
+            Readings at or above this move to a shorter integration time
+*/
+void Adafruit_VCNL4040::setAmbientAutoRangeLimits(uint16_t low_counts,
+                                                  uint16_t high_counts) {
+  _als_auto_low = low_counts;
+  _als_auto_high = high_counts;
+}
+
+/**************************************************************************/
+/*!
+    @brief Reads the ambient light in millilux along with the integration
+           time it was measured at, adjusting the integration time for the
+           next reading if automatic ranging is enabled.
+    @param  millilux
+            Where to store the ambient light measurement in millilux
+    @param  integration_time
+            Where to store the integration time of the measurement
+    @return True if a reading was taken, false if the sensor is still
+            settling after a change of integration time or the read failed
+*/
+bool Adafruit_VCNL4040::getAutoRangedLux(
+    uint32_t *millilux, VCNL4040_AmbientIntegration *integration_time) {
+  uint16_t counts;
+
+  if (ambientSettling()) {
+    return false;
+  }
+  if (!_readRegister(VCNL4040_ALS_DATA, &counts)) {
+    return false;
+  }
+  *integration_time = getAmbientIntegrationTime();
+  *millilux = countsToMilliLux(counts, *integration_time);
+
+  _resetLightReady(1);
+  // stored before ranging, so it keeps the integration time it was taken at
+  _storeReading(1, counts);
+  _autoRange(counts);
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Steps the ambient light integration time if automatic ranging is
+           enabled and a reading is outside the auto range limits
+    @param  counts
+            The raw ambient light reading
+*/
+void Adafruit_VCNL4040::_autoRange(uint16_t counts) {
+  uint8_t integration_time = getAmbientIntegrationTime();
+
+  if (!_als_auto_range) {
+    return;
+  }
+  if (counts >= _als_auto_high &&
+      integration_time > VCNL4040_AMBIENT_INTEGRATION_TIME_80MS) {
+    requestAmbientIntegrationTime(
+        (VCNL4040_AmbientIntegration)(integration_time - 1));
+  } else if (counts < _als_auto_low &&
+             integration_time < VCNL4040_AMBIENT_INTEGRATION_TIME_640MS) {
+    requestAmbientIntegrationTime(
+        (VCNL4040_AmbientIntegration)(integration_time + 1));
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Gets the current for the LED used for proximity measurements.
+    @returns The LED current value being used for proximity measurements.
+*/
+VCNL4040_LEDCurrent Adafruit_VCNL4040::getProximityLEDCurrent(void) {
+  return (VCNL4040_LEDCurrent)((_ps_ms >> 8) & 0x7);
+} /**************************************************************************/
+/*!
+    @brief Sets the current for the LED used for proximity measurements.
+    @param  led_current
+            The current value to be used for proximity measurements. Must be a
+            `VCNL4040_LEDCurrent`.
 */
 void Adafruit_VCNL4040::setProximityLEDCurrent(
     VCNL4040_LEDCurrent led_current) {
-  Adafruit_BusIO_RegisterBits led_current_config =
-      Adafruit_BusIO_RegisterBits(PS_MS, 3, 8);
-  led_current_config.write(led_current);
+  _writeConfigBits(VCNL4040_PS_MS_H, &_ps_ms, 3, 8, led_current);
 }
 
 /**************************************************************************/
@@ -419,9 +1412,7 @@ void Adafruit_VCNL4040::setProximityLEDCurrent(
     @returns The duty cycle value being used for proximity measurements.
 */
 VCNL4040_LEDDutyCycle Adafruit_VCNL4040::getProximityLEDDutyCycle(void) {
-  Adafruit_BusIO_RegisterBits led_duty_cycle_config =
-      Adafruit_BusIO_RegisterBits(PS_CONFIG_12, 2, 6);
-  return (VCNL4040_LEDDutyCycle)led_duty_cycle_config.read();
+  return (VCNL4040_LEDDutyCycle)((_ps_config_12 >> 6) & 0x3);
 }
 /**************************************************************************/
 /*!
@@ -432,9 +1423,63 @@ VCNL4040_LEDDutyCycle Adafruit_VCNL4040::getProximityLEDDutyCycle(void) {
 */
 void Adafruit_VCNL4040::setProximityLEDDutyCycle(
     VCNL4040_LEDDutyCycle duty_cycle) {
-  Adafruit_BusIO_RegisterBits led_duty_cycle_config =
-      Adafruit_BusIO_RegisterBits(PS_CONFIG_12, 2, 6);
-  led_duty_cycle_config.write(duty_cycle);
+  _writeConfigBits(VCNL4040_PS_CONF1_L, &_ps_config_12, 2, 6, duty_cycle);
+  _resetProximityReady();
+}
+
+/**************************************************************************/
+/*!
+    @brief Sets the proximity LED duty cycle and integration time together
+           with one write to PS_CONFIG_12. Unlike the individual setters this
+           writes straight away even inside a configuration batch, without
+           writing the batch's other staged changes, so it can be used by
+           code running inside `readAll` such as a sample listener.
+    @param  duty_cycle
+            The duty cycle to use. Must be a `VCNL4040_LEDDutyCycle`.
+    @param  integration_time
+            The integration time to use. Must be a
+            `VCNL4040_ProximityIntegration`.
+    @return True if the write was successful
+*/
+bool Adafruit_VCNL4040::setProximityTiming(
+    VCNL4040_LEDDutyCycle duty_cycle,
+    VCNL4040_ProximityIntegration integration_time) {
+  uint16_t mask = (0x3 << 6) | (0x7 << 1);
+  uint16_t timing = ((duty_cycle << 6) | (integration_time << 1)) & mask;
+  // inside a batch, start from what the sensor holds rather than the staged
+  // value, and keep the batch's record of it in step
+  uint16_t config =
+      ((_config_batch ? _batch_ps_config_12 : _ps_config_12) & ~mask) | timing;
+
+  if (!_writeRegister(VCNL4040_PS_CONF1_L, config)) {
+    return false;
+  }
+  if (_config_batch) {
+    _batch_ps_config_12 = config;
+  }
+  _ps_config_12 = (_ps_config_12 & ~mask) | timing;
+  _cache_valid = 0;
+  _resetProximityReady();
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Estimates the average current drawn by the proximity LED from the
+           LED current, duty cycle and number of pulses per measurement
+    @return The average LED current in microamps while measuring
+            continuously, or 0 if proximity measurements are disabled
+*/
+uint32_t Adafruit_VCNL4040::getProximityAverageLEDCurrent(void) {
+  if (_ps_config_12 & 0x1) {
+    return 0;
+  }
+  // the LED is on for 1/40 of the time at a 1/40 duty cycle, and each
+  // extra pulse adds another integration time
+  uint32_t peak_ua = (uint32_t)led_current_ma[(_ps_ms >> 8) & 0x7] * 1000;
+  uint8_t pulses = 1 << ((_ps_ms >> 5) & 0x3);
+
+  return (peak_ua * pulses) / (40 << ((_ps_config_12 >> 6) & 0x3));
 }
 
 /**************************************************************************/
@@ -445,9 +1490,7 @@ void Adafruit_VCNL4040::setProximityLEDDutyCycle(
             If false, proximity measurements are 12-bit,
 */
 bool Adafruit_VCNL4040::getProximityHighResolution(void) {
-  Adafruit_BusIO_RegisterBits ps_hd =
-      Adafruit_BusIO_RegisterBits(PS_CONFIG_12, 1, 11);
-  return (bool)ps_hd.read();
+  return (bool)((_ps_config_12 >> 11) & 0x1);
 }
 /**************************************************************************/
 /*!
@@ -457,7 +1500,783 @@ bool Adafruit_VCNL4040::getProximityHighResolution(void) {
             set to faluse to use 12-bit measurements.
 */
 void Adafruit_VCNL4040::setProximityHighResolution(bool high_resolution) {
-  Adafruit_BusIO_RegisterBits ps_hd =
-      Adafruit_BusIO_RegisterBits(PS_CONFIG_12, 1, 11);
-  ps_hd.write(high_resolution);
+  _writeConfigBits(VCNL4040_PS_CONF1_L, &_ps_config_12, 1, 11, high_resolution);
+}
+
+/******************** Persistence and Filtering Functions *************** */
+
+/**************************************************************************/
+/*!
+    @brief Gets the number of consecutive ambient light measurements outside
+           the thresholds needed to raise an interrupt
+    @return The current `VCNL4040_AmbientPersistence`
+*/
+VCNL4040_AmbientPersistence Adafruit_VCNL4040::getAmbientPersistence(void) {
+  return (VCNL4040_AmbientPersistence)((_als_config >> 2) & 0x3);
+}
+
+/**************************************************************************/
+/*!
+    @brief Sets the number of consecutive ambient light measurements outside
+           the thresholds needed to raise an interrupt. Filtering in the
+           sensor costs no bus traffic, unlike debouncing readings in
+           software.
+    @param  persistence
+            The persistence to use. Must be a `VCNL4040_AmbientPersistence`.
+*/
+void Adafruit_VCNL4040::setAmbientPersistence(
+    VCNL4040_AmbientPersistence persistence) {
+  _writeConfigBits(VCNL4040_ALS_CONFIG, &_als_config, 2, 2, persistence);
+}
+
+/**************************************************************************/
+/*!
+    @brief Gets the number of consecutive proximity measurements outside the
+           thresholds needed to raise an interrupt
+    @return The current `VCNL4040_ProximityPersistence`
+*/
+VCNL4040_ProximityPersistence Adafruit_VCNL4040::getProximityPersistence(void) {
+  return (VCNL4040_ProximityPersistence)((_ps_config_12 >> 4) & 0x3);
+}
+
+/**************************************************************************/
+/*!
+    @brief Sets the number of consecutive proximity measurements outside the
+           thresholds needed to raise an interrupt
+    @param  persistence
+            The persistence to use. Must be a `VCNL4040_ProximityPersistence`.
+*/
+void Adafruit_VCNL4040::setProximityPersistence(
+    VCNL4040_ProximityPersistence persistence) {
+  _writeConfigBits(VCNL4040_PS_CONF1_L, &_ps_config_12, 2, 4, persistence);
+}
+
+/**************************************************************************/
+/*!
+    @brief Gets whether proximity smart persistence is enabled
+    @return True if smart persistence is enabled
+*/
+bool Adafruit_VCNL4040::getProximitySmartPersistence(void) {
+  return (bool)((_ps_ms >> 4) & 0x1);
+}
+
+/**************************************************************************/
+/*!
+    @brief Enables or disables proximity smart persistence. When enabled, a
+           measurement that crosses a threshold is confirmed by the rest of
+           the persistence count measured back to back, rather than one
+           measurement period apart, so debouncing adds little latency.
+    @param  enable
+            Set to true to enable smart persistence, false to disable
+*/
+void Adafruit_VCNL4040::enableProximitySmartPersistence(bool enable) {
+  _writeConfigBits(VCNL4040_PS_MS_H, &_ps_ms, 1, 4, enable);
+}
+
+/**************************************************************************/
+/*!
+    @brief Gets the number of LED pulses per proximity measurement
+    @return The current `VCNL4040_ProximityMultiPulse`
+*/
+VCNL4040_ProximityMultiPulse Adafruit_VCNL4040::getProximityMultiPulse(void) {
+  return (VCNL4040_ProximityMultiPulse)((_ps_ms >> 5) & 0x3);
+}
+
+/**************************************************************************/
+/*!
+    @brief Sets the number of LED pulses per proximity measurement. More
+           pulses give a larger, less noisy reading for the same integration
+           time, at the cost of LED current.
+    @param  pulses
+            The number of pulses to use. Must be a
+            `VCNL4040_ProximityMultiPulse`.
+*/
+void Adafruit_VCNL4040::setProximityMultiPulse(
+    VCNL4040_ProximityMultiPulse pulses) {
+  _writeConfigBits(VCNL4040_PS_MS_H, &_ps_ms, 2, 5, pulses);
+  _resetProximityReady();
+}
+
+/**************************************************************************/
+/*!
+    @brief Gets the settings that affect proximity readings, packed into one
+           value as kept in each `VCNL4040_Sample`
+    @return The `VCNL4040_ProximityIntegration` in bits 0-2, the
+            `VCNL4040_LEDDutyCycle` in bits 3-4, the `VCNL4040_LEDCurrent` in
+            bits 5-7, the `VCNL4040_ProximityMultiPulse` in bits 8-9 and the
+            high resolution setting in bit 10
+*/
+uint16_t Adafruit_VCNL4040::getProximityConfig(void) {
+  return getProximityIntegrationTime() |
+         ((uint16_t)getProximityLEDDutyCycle() << 3) |
+         ((uint16_t)getProximityLEDCurrent() << 5) |
+         ((uint16_t)getProximityMultiPulse() << 8) |
+         ((uint16_t)getProximityHighResolution() << 10);
+}
+
+/**************************************************************************/
+/*!
+    @brief Gets whether proximity sunlight cancellation is enabled
+    @return True if sunlight cancellation is enabled
+*/
+bool Adafruit_VCNL4040::getSunlightCancellation(void) {
+  return (bool)(_ps_ms & 0x1);
+}
+
+/**************************************************************************/
+/*!
+    @brief Enables or disables proximity sunlight cancellation, which keeps
+           strong sunlight from raising false proximity readings
+    @param  enable
+            Set to true to enable sunlight cancellation, false to disable
+*/
+void Adafruit_VCNL4040::enableSunlightCancellation(bool enable) {
+  _writeConfigBits(VCNL4040_PS_MS_H, &_ps_ms, 1, 0, enable);
+}
+
+/******************** Active Force Functions **************************** */
+
+/**************************************************************************/
+/*!
+    @brief Enables or disables active force mode, in which the sensor only
+           takes a proximity measurement when triggered by
+           `triggerProximity` rather than measuring continuously.
+    @param  enable
+            Set to true to enable active force mode,
+            set to false to measure continuously.
+*/
+void Adafruit_VCNL4040::enableProximityActiveForce(bool enable) {
+  _writeConfigBits(VCNL4040_PS_MS_H, &_ps_ms, 1, 3, enable);
+  _ps_trigger_pending = false;
+}
+
+/**************************************************************************/
+/*!
+    @brief Gets whether active force mode is enabled
+    @return True if proximity measurements are only taken when triggered
+*/
+bool Adafruit_VCNL4040::getProximityActiveForce(void) {
+  return (bool)((_ps_ms >> 3) & 0x1);
+}
+
+/**************************************************************************/
+/*!
+    @brief Starts a single proximity measurement, enabling active force mode
+           if it isn't already enabled. Proximity measurements must be
+           enabled with `enableProximity`. The result is collected with
+           `pollProximityResult`.
+    @return True if the measurement was started
+*/
+bool Adafruit_VCNL4040::triggerProximity(void) {
+  // inside a batch, start from what the sensor holds rather than the staged
+  // value, so the batch's other changes still wait for the commit
+  uint16_t ps_ms = (_config_batch ? _batch_ps_ms : _ps_ms) | (1 << 3);
+
+  // PS_TRIG clears itself once the measurement has started, so it is written
+  // along with PS_AF but kept out of the shadow
+  if (!_writeRegister(VCNL4040_PS_MS_H, ps_ms | (1 << 2))) {
+    return false;
+  }
+  if (_config_batch) {
+    _batch_ps_ms = ps_ms;
+  }
+  _ps_ms |= 1 << 3;
+
+  // a single measurement takes one cycle at the shortest (1/40) duty cycle
+  uint32_t measurement_us =
+      (uint32_t)proximity_half_t[(_ps_config_12 >> 1) & 0x7] * 2500;
+  _startWait(0, (measurement_us + 999) / 1000);
+  _ps_trigger_pending = true;
+  _cache_valid &= ~0x1;
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Collects the result of a measurement started by
+           `triggerProximity` once it is complete. Doesn't touch the bus
+           until then.
+    @param  proximity
+            Where to store the proximity measurement
+    @return True if the measurement was complete and has been read,
+            false if it is still in progress or none was triggered
+*/
+bool Adafruit_VCNL4040::pollProximityResult(uint16_t *proximity) {
+  if (!_ps_trigger_pending || !proximityDataReady()) {
+    return false;
+  }
+  if (!_readRegister(VCNL4040_PS_DATA, proximity)) {
+    return false;
+  }
+  _ps_trigger_pending = false;
+  _resetProximityReady();
+  _storeReading(0, *proximity);
+  return true;
+}
+
+/******************** Data Ready Functions ****************************** */
+
+/**************************************************************************/
+/*!
+    @brief Gets the time the sensor takes to produce a new proximity
+           measurement with the current integration time and LED duty cycle
+    @return The proximity measurement period in milliseconds
+*/
+uint16_t Adafruit_VCNL4040::getProximityMeasurementPeriod(void) {
+  // the LED is on for one integration time out of every 40 (for a 1/40 duty
+  // cycle), 80, 160 or 320
+  uint32_t period_us =
+      (uint32_t)proximity_half_t[(_ps_config_12 >> 1) & 0x7] * 2500;
+  period_us <<= (_ps_config_12 >> 6) & 0x3;
+
+  return (period_us + 999) / 1000;
+}
+
+/**************************************************************************/
+/*!
+    @brief Gets the time the sensor takes to produce a new ambient and white
+           light measurement with the current integration time
+    @return The ambient light measurement period in milliseconds
+*/
+uint16_t Adafruit_VCNL4040::getAmbientMeasurementPeriod(void) {
+  return 80 << ((_als_config >> 6) & 0x3);
+}
+
+/**************************************************************************/
+/*!
+    @brief Checks whether the sensor should have completed a new proximity
+           measurement since proximity was last read or reconfigured
+    @return True if a fresh proximity measurement is available
+*/
+bool Adafruit_VCNL4040::proximityDataReady(void) {
+  return _dataReady(0, millis());
+}
+
+/**************************************************************************/
+/*!
+    @brief Checks whether the sensor should have completed a new ambient and
+           white light measurement since they were last read or reconfigured
+    @return True if a fresh ambient light measurement is available
+*/
+bool Adafruit_VCNL4040::ambientDataReady(void) {
+  return _dataReady(1, millis());
+}
+
+/*!
+    @brief Starts waiting for a channel's next measurement
+    @param  index
+            The channel: 0 for proximity, 1 for ambient, 2 for white light
+    @param  wait_ms
+            How long from now the measurement is due
+*/
+void Adafruit_VCNL4040::_startWait(uint8_t index, uint16_t wait_ms) {
+  _wait_start_ms[index] = millis();
+  _wait_ms[index] = wait_ms;
+  _data_waiting |= 1 << index;
+}
+
+/*!
+    @brief Checks whether a channel's next measurement is due. The wait is
+           timed from its start, and ended the first time it is seen to be
+           over, so a long idle or the clock wrapping can't make old data
+           look like it is still on its way.
+    @param  index
+            The channel: 0 for proximity, 1 for ambient, 2 for white light
+    @param  now_ms
+            The current time from `millis()`
+    @return True if a new measurement should be available
+*/
+bool Adafruit_VCNL4040::_dataReady(uint8_t index, uint32_t now_ms) {
+  uint8_t bit = 1 << index;
+
+  if (index == 0 && getProximityActiveForce() && !_ps_trigger_pending) {
+    // in active force mode only a triggered measurement brings new data
+    return false;
+  }
+  if ((_data_waiting & bit) &&
+      (uint32_t)(now_ms - _wait_start_ms[index]) >= _wait_ms[index]) {
+    _data_waiting &= ~bit;
+  }
+  return !(_data_waiting & bit);
+}
+
+/**************************************************************************/
+/*!
+    @brief Marks the current proximity measurement as used, so proximity
+           data is next ready one measurement period from now
+*/
+void Adafruit_VCNL4040::_resetProximityReady(void) {
+  _cache_valid &= ~0x1;
+  if (_ps_trigger_pending && !(_data_waiting & 0x1)) {
+    // the triggered measurement was complete, so this read used it up
+    _ps_trigger_pending = false;
+  }
+  if (_ps_trigger_pending || getProximityActiveForce()) {
+    // data is due when the triggered measurement completes, and in active
+    // force mode there is none until the next trigger
+    return;
+  }
+  _startWait(0, getProximityMeasurementPeriod());
+}
+
+/**************************************************************************/
+/*!
+    @brief Marks the current ambient and white light measurements as used,
+           so both are next ready one measurement period from now
+*/
+void Adafruit_VCNL4040::_resetAmbientReady(void) {
+  _resetLightReady(1);
+  _resetLightReady(2);
+}
+
+/**************************************************************************/
+/*!
+    @brief Marks the current ambient or white light measurement as used, so
+           that channel is next ready one measurement period from now. The
+           other channel keeps its own deadline and cached reading.
+    @param  index
+            The reading: 1 for ambient, 2 for white light
+*/
+void Adafruit_VCNL4040::_resetLightReady(uint8_t index) {
+  _cache_valid &= ~(1 << index);
+  if (ambientSettling()) {
+    // data is already due at the end of the settling time
+    return;
+  }
+  _startWait(index, getAmbientMeasurementPeriod());
+}
+
+/******************** Result Cache Functions **************************** */
+
+/**************************************************************************/
+/*!
+    @brief Enables or disables the result cache. When enabled,
+           `getProximity`, `getAmbientLight`, `getLux`, `getMilliLux`,
+           `getWhiteLight` and `getWhiteLightMilli` return the last value
+           read, without touching the bus, until the sensor should have
+           completed a new measurement. How long that takes follows the
+           configured integration times and proximity duty cycle, and any
+           configuration change empties the cache. Hits and misses are
+           counted in the bus stats.
+    @param  enable
+            Set to true to enable the cache, false to read on every call
+*/
+/**************************************************************************/
+void Adafruit_VCNL4040::enableResultCache(bool enable) {
+  _cache_enabled = enable;
+  _cache_valid = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief Looks up a reading in the result cache
+    @param  index
+            The reading: 0 for proximity, 1 for ambient, 2 for white light
+    @param  value
+            Where to store the cached reading
+    @return True if the cache holds a reading that is still current
+*/
+/**************************************************************************/
+bool Adafruit_VCNL4040::_cachedReading(uint8_t index, uint16_t *value) {
+  if (!_cache_enabled) {
+    return false;
+  }
+  if (!(_cache_valid & (1 << index)) || _dataReady(index, millis())) {
+    _bus_stats.cache_misses++;
+    return false;
+  }
+  _bus_stats.cache_hits++;
+  // the reading is valid, whatever happened on the bus since
+  _last_transaction_ok = true;
+  *value = _readings[index];
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Keeps a reading just taken, along with the ambient light
+           integration time it was taken at, and adds it to the result cache
+    @param  index
+            The reading: 0 for proximity, 1 for ambient, 2 for white light
+    @param  value
+            The reading
+*/
+/**************************************************************************/
+void Adafruit_VCNL4040::_storeReading(uint8_t index, uint16_t value) {
+  _readings[index] = value;
+  if (index) {
+    _light_integration[index - 1] = getAmbientIntegrationTime();
+  }
+  if (_cache_enabled) {
+    _cache_valid |= 1 << index;
+  }
+}
+
+/******************** Bus Health Functions ****************************** */
+
+/**************************************************************************/
+/*!
+    @brief Copies the bus health counters, which are kept as the driver
+           runs, so reading them costs no bus traffic
+    @param  stats
+            Where to store the counters
+*/
+void Adafruit_VCNL4040::getBusStats(VCNL4040_BusStats *stats) {
+  *stats = _bus_stats;
+}
+
+/**************************************************************************/
+/*!
+    @brief Sets all of the bus health counters to zero
+*/
+void Adafruit_VCNL4040::resetBusStats(void) {
+  memset(&_bus_stats, 0, sizeof(_bus_stats));
+}
+
+/**************************************************************************/
+/*!
+    @brief Sets how many times a failed transaction is retried before a
+           register access fails. Each retry is counted in the bus stats.
+    @param  retries
+            The number of retries, 0 to fail on the first error
+*/
+void Adafruit_VCNL4040::setRetryLimit(uint8_t retries) {
+  _retry_limit = retries;
+}
+
+/**************************************************************************/
+/*!
+    @brief Checks whether the last register access succeeded, so the value
+           returned by a getter such as `getProximity` can be trusted.
+           Getters return 0 when their read fails. A reading answered
+           without the bus, from the result cache or while the ambient
+           light sensor is settling, counts as a success.
+    @return True if the last register read or write, or the last reading
+            answered without the bus, succeeded
+*/
+bool Adafruit_VCNL4040::lastTransactionOk(void) {
+  return _last_transaction_ok;
+}
+
+/******************** Configuration Shadow Functions ******************** */
+
+/**************************************************************************/
+/*!
+    @brief Applies a complete configuration, writing each configuration
+           register once without reading it first, plus any thresholds set
+           in the configuration.
+    @param  config
+            The `VCNL4040_Config` to apply
+    @return True if all of the registers were written successfully
+*/
+bool Adafruit_VCNL4040::applyConfig(const VCNL4040_Config &config) {
+  if (!_writeRegister(VCNL4040_ALS_CONFIG, config._als_config) ||
+      !_writeRegister(VCNL4040_PS_CONF1_L, config._ps_config_12) ||
+      !_writeRegister(VCNL4040_PS_MS_H, config._ps_ms)) {
+    return false;
+  }
+  _als_config = config._als_config;
+  _ps_config_12 = config._ps_config_12;
+  _ps_ms = config._ps_ms;
+  _cache_valid = 0;
+  _resetProximityReady();
+  _resetAmbientReady();
+
+  if (config._thresholds & 0x1) {
+    if (!_writeRegister(VCNL4040_ALS_THDL, config._als_low_threshold) ||
+        !_writeRegister(VCNL4040_ALS_THDH, config._als_high_threshold)) {
+      return false;
+    }
+    _als_thdl = config._als_low_threshold;
+    _als_thdh = config._als_high_threshold;
+    _als_thresholds_known = 0x3;
+  }
+  if (config._thresholds & 0x2) {
+    return _writeRegister(VCNL4040_PS_THDL, config._ps_low_threshold) &&
+           _writeRegister(VCNL4040_PS_THDH, config._ps_high_threshold);
+  }
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Starts a configuration batch. Until `commitConfigBatch` is called,
+           configuration setters such as `setProximityLEDCurrent` and
+           `setProximityIntegrationTime` only update the driver's shadow
+           copies, so that retuning several settings costs at most one write
+           per configuration register.
+*/
+void Adafruit_VCNL4040::beginConfigBatch(void) {
+  if (_config_batch) {
+    return;
+  }
+  _batch_als_config = _als_config;
+  _batch_ps_config_12 = _ps_config_12;
+  _batch_ps_ms = _ps_ms;
+  _config_batch = true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Ends a configuration batch started by `beginConfigBatch`,
+           writing each configuration register that was changed once
+    @return True if the changed registers were written successfully. On
+            failure the batch is ended and `restoreConfig` can be used to
+            retry the writes.
+*/
+bool Adafruit_VCNL4040::commitConfigBatch(void) {
+  if (!_config_batch) {
+    return true;
+  }
+  _config_batch = false;
+
+  if ((_als_config != _batch_als_config &&
+       !_writeRegister(VCNL4040_ALS_CONFIG, _als_config)) ||
+      (_ps_config_12 != _batch_ps_config_12 &&
+       !_writeRegister(VCNL4040_PS_CONF1_L, _ps_config_12)) ||
+      (_ps_ms != _batch_ps_ms && !_writeRegister(VCNL4040_PS_MS_H, _ps_ms))) {
+    return false;
+  }
+  _cache_valid = 0;
+  if ((_als_config ^ _batch_als_config) & (0x3 << 6)) {
+    _startAmbientSettling(_batch_als_config);
+  }
+  _resetProximityReady();
+  _resetAmbientReady();
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Ends a configuration batch started by `beginConfigBatch` without
+           writing anything, returning the configuration getters to the
+           values before the batch
+*/
+void Adafruit_VCNL4040::discardConfigBatch(void) {
+  if (!_config_batch) {
+    return;
+  }
+  _als_config = _batch_als_config;
+  _ps_config_12 = _batch_ps_config_12;
+  _ps_ms = _batch_ps_ms;
+  _config_batch = false;
+}
+
+/**************************************************************************/
+/*!
+    @brief Reads the configuration registers from the sensor into the
+           driver's shadow copies. Configuration getters are answered from
+           these copies without touching the bus.
+    @return True if all three registers were read successfully
+*/
+bool Adafruit_VCNL4040::syncConfig(void) {
+  uint16_t als_config, ps_config_12, ps_ms;
+
+  if (!_readRegister(VCNL4040_ALS_CONFIG, &als_config) ||
+      !_readRegister(VCNL4040_PS_CONF1_L, &ps_config_12) ||
+      !_readRegister(VCNL4040_PS_MS_H, &ps_ms)) {
+    return false;
+  }
+  _als_config = als_config;
+  _ps_config_12 = ps_config_12;
+  // PS_TRIG clears itself, so it is never kept in the shadow or every later
+  // PS_MS write would start another measurement
+  _ps_ms = ps_ms & ~(1 << 2);
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Checks that the sensor's configuration registers still match the
+           driver's shadow copies, for example after a brownout reset
+    @return True if the sensor configuration matches, false if it differs or
+            could not be read
+*/
+bool Adafruit_VCNL4040::verifyConfig(void) {
+  uint16_t als_config, ps_config_12, ps_ms;
+
+  if (!_readRegister(VCNL4040_ALS_CONFIG, &als_config) ||
+      !_readRegister(VCNL4040_PS_CONF1_L, &ps_config_12) ||
+      !_readRegister(VCNL4040_PS_MS_H, &ps_ms)) {
+    return false;
+  }
+  // PS_TRIG clears itself, so it is never set in the shadow
+  ps_ms &= ~(1 << 2);
+  return (als_config == _als_config) && (ps_config_12 == _ps_config_12) &&
+         (ps_ms == _ps_ms);
+}
+
+/**************************************************************************/
+/*!
+    @brief Writes the driver's shadow copies back to the sensor's
+           configuration registers, restoring the configuration after the
+           sensor has been reset
+    @return True if all three registers were written successfully
+*/
+bool Adafruit_VCNL4040::restoreConfig(void) {
+  return _writeRegister(VCNL4040_ALS_CONFIG, _als_config) &&
+         _writeRegister(VCNL4040_PS_CONF1_L, _ps_config_12) &&
+         _writeRegister(VCNL4040_PS_MS_H, _ps_ms);
+}
+
+/**************************************************************************/
+/*!
+    @brief Reads one of the sensor's 16-bit registers in a single
+           write-then-read transaction
+    @param  reg
+            The command code of the register to read
+    @param  value
+            Where to store the value read
+    @return True if the read was successful
+*/
+bool Adafruit_VCNL4040::_readRegister(uint8_t reg, uint16_t *value) {
+  uint8_t buffer[2];
+
+  if (!_transfer(&reg, 1, buffer, 2)) {
+    return false;
+  }
+  *value = buffer[0] | ((uint16_t)buffer[1] << 8);
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Reads several of the sensor's 16-bit registers. When the I2C
+           device can batch register reads, as the Linux i2c-dev backend in
+           extras/linux can, they are read in one transaction; otherwise one
+           transaction is used for each.
+    @param  regs
+            The command codes of the registers to read
+    @param  values
+            Where to store the values, in the order of `regs`
+    @param  count
+            The number of registers to read
+    @return True if every read was successful
+*/
+bool Adafruit_VCNL4040::_readRegisters(const uint8_t *regs, uint16_t *values,
+                                       uint8_t count) {
+#ifdef ADAFRUIT_I2CDEVICE_READ_REGISTERS
+  uint8_t buffer[2 * VCNL4040_MAX_REGISTER_READS];
+
+  if (count > 1 && count <= VCNL4040_MAX_REGISTER_READS) {
+    if (!_transfer(regs, count, buffer, 2 * count, true)) {
+      return false;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+      values[i] = buffer[2 * i] | ((uint16_t)buffer[2 * i + 1] << 8);
+    }
+    return true;
+  }
+#endif
+  for (uint8_t i = 0; i < count; i++) {
+    if (!_readRegister(regs[i], &values[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Writes one of the sensor's 16-bit registers in a single
+           transaction
+    @param  reg
+            The command code of the register to write
+    @param  value
+            The value to write
+    @return True if the write was successful
+*/
+bool Adafruit_VCNL4040::_writeRegister(uint8_t reg, uint16_t value) {
+  uint8_t buffer[3] = {reg, (uint8_t)(value & 0xFF), (uint8_t)(value >> 8)};
+
+  return _transfer(buffer, 3, NULL, 0);
+}
+
+/**************************************************************************/
+/*!
+    @brief Runs one register access on the bus, retrying failed transactions
+           up to the retry limit and updating the bus health counters
+    @param  write_buffer
+            The bytes to write, starting with the command code
+    @param  write_len
+            The number of bytes to write
+    @param  read_buffer
+            Where to store the bytes read, or NULL for a write
+    @param  read_len
+            The number of bytes to read after writing
+    @param  each_register
+            Set to true to treat each byte written as a command code, with
+            `read_len / write_len` bytes read back after each, as one
+            transaction. Needs `ADAFRUIT_I2CDEVICE_READ_REGISTERS`.
+    @return True if one of the attempts succeeded
+*/
+bool Adafruit_VCNL4040::_transfer(const uint8_t *write_buffer,
+                                  size_t write_len, uint8_t *read_buffer,
+                                  size_t read_len, bool each_register) {
+  uint32_t start_us = micros();
+  bool ok = false;
+
+  for (uint8_t attempt = 0; !ok && attempt <= _retry_limit; attempt++) {
+    if (attempt) {
+      _bus_stats.retries++;
+    }
+    _bus_stats.transactions++;
+    if (each_register) {
+#ifdef ADAFRUIT_I2CDEVICE_READ_REGISTERS
+      ok = _i2c_dev.read_registers(write_buffer, write_len, read_buffer,
+                                   read_len / write_len);
+#endif
+    } else if (read_len) {
+      ok = _i2c_dev.write_then_read(write_buffer, write_len, read_buffer,
+                                    read_len);
+    } else {
+      ok = _i2c_dev.write(write_buffer, write_len);
+    }
+    if (!ok) {
+      _bus_stats.errors++;
+    }
+  }
+  if (!ok) {
+    _bus_stats.failures++;
+  }
+
+  uint32_t elapsed_us = micros() - start_us;
+  _bus_stats.total_us += elapsed_us;
+  if (elapsed_us > _bus_stats.max_us) {
+    _bus_stats.max_us = elapsed_us;
+  }
+  _last_transaction_ok = ok;
+  return ok;
+}
+
+/**************************************************************************/
+/*!
+    @brief Updates a field in one of the configuration registers with a single
+           bus write, using the shadow copy in place of a read-modify-write.
+           Inside a configuration batch only the shadow copy is updated.
+    @param  reg
+            The command code of the configuration register to write
+    @param  shadow
+            The shadow copy of the register
+    @param  bits
+            The width of the field in bits
+    @param  shift
+            The position of the field's lowest bit
+    @param  value
+            The new value of the field
+    @return True if the write was successful
+*/
+bool Adafruit_VCNL4040::_writeConfigBits(uint8_t reg, uint16_t *shadow,
+                                         uint8_t bits, uint8_t shift,
+                                         uint16_t value) {
+  uint16_t mask = ((1 << bits) - 1) << shift;
+  uint16_t config = (*shadow & ~mask) | ((value << shift) & mask);
+
+  if (!_config_batch && !_writeRegister(reg, config)) {
+    return false;
+  }
+  // readings taken with the old settings may no longer apply
+  _cache_valid = 0;
+  *shadow = config;
+  return true;
 }
@@ -33,6 +33,7 @@
 #define VCNL4040_PS_CONF1_L                                                    \
   0x03                         ///< Proximity sensor configuration 1/2 register
 #define VCNL4040_PS_MS_H 0x04  ///< Proximity sensor configuration 1/2 register
+#define VCNL4040_PS_CANC 0x05  ///< Proximity sensor cancellation register
 #define VCNL4040_PS_THDL 0x06  ///< Proximity sensor low threshold register
 #define VCNL4040_PS_THDH 0x07  ///< Proximity sensor high threshold register
 #define VCNL4040_PS_DATA 0x08  ///< Proximity sensor data register
@@ -108,6 +109,44 @@ typedef enum proximity_type {
   VCNL4040_PROXIMITY_INT_CLOSE_AWAY,
 } VCNL4040_ProximityType;
 
+/**
+ * @brief Ambient light interrupt persistence values
+ *
+ * The number of consecutive out-of-threshold measurements needed to raise an
+ * ambient light interrupt. Allowed values for `setAmbientPersistence`.
+ */
+typedef enum ambient_persistence {
+  VCNL4040_AMBIENT_PERSISTENCE_1,
+  VCNL4040_AMBIENT_PERSISTENCE_2,
+  VCNL4040_AMBIENT_PERSISTENCE_4,
+  VCNL4040_AMBIENT_PERSISTENCE_8,
+} VCNL4040_AmbientPersistence;
+
+/**
+ * @brief Proximity interrupt persistence values
+ *
+ * The number of consecutive out-of-threshold measurements needed to raise a
+ * proximity interrupt. Allowed values for `setProximityPersistence`.
+ */
+typedef enum proximity_persistence {
+  VCNL4040_PROXIMITY_PERSISTENCE_1,
+  VCNL4040_PROXIMITY_PERSISTENCE_2,
+  VCNL4040_PROXIMITY_PERSISTENCE_3,
+  VCNL4040_PROXIMITY_PERSISTENCE_4,
+} VCNL4040_ProximityPersistence;
+
+/**
+ * @brief Proximity LED pulses per measurement
+ *
+ * Allowed values for `setProximityMultiPulse`.
+ */
+typedef enum proximity_multi_pulse {
+  VCNL4040_PROXIMITY_PULSES_1,
+  VCNL4040_PROXIMITY_PULSES_2,
+  VCNL4040_PROXIMITY_PULSES_4,
+  VCNL4040_PROXIMITY_PULSES_8,
+} VCNL4040_ProximityMultiPulse;
+
 /**
  * @brief Interrupt types
  *
@@ -121,19 +160,411 @@ typedef enum interrupt_type {
   VCNL4040_PROXIMITY_PROTECT_MODE = 1 << 6
 } VCNL4040_InterruptType;
 
+/**
+ * @brief Sample flags
+ *
+ * Values to be matched against the `flags` of a `VCNL4040_Sample`.
+ */
+typedef enum sample_flag {
+  VCNL4040_SAMPLE_PROXIMITY_FRESH = 1,
+  VCNL4040_SAMPLE_AMBIENT_FRESH = 1 << 1,
+  VCNL4040_SAMPLE_AMBIENT_SETTLING = 1 << 2,
+  VCNL4040_SAMPLE_REPLAYED = 1 << 3,
+} VCNL4040_SampleFlag;
+
+/**
+ * @brief Long-running operations
+ *
+ * Operations started by a request call and advanced by `tick`, as passed to
+ * a `VCNL4040_OperationCallback`.
+ */
+typedef enum operation {
+  VCNL4040_OPERATION_NONE,
+  VCNL4040_OPERATION_CALIBRATION,
+  VCNL4040_OPERATION_AMBIENT_SETTLE,
+} VCNL4040_Operation;
+
+/**
+ * @brief Operation status values
+ *
+ * Values returned by `getOperationStatus`.
+ */
+typedef enum operation_status {
+  VCNL4040_STATUS_IDLE,
+  VCNL4040_STATUS_BUSY,
+  VCNL4040_STATUS_DONE,
+  VCNL4040_STATUS_FAILED,
+} VCNL4040_OperationStatus;
+
+/**
+ * @brief A set of readings taken together by `readAll`
+ */
+typedef struct vcnl4040_sample {
+  uint32_t timestamp;          ///< `millis()` when the sample was read
+  uint16_t proximity;          ///< Raw proximity measurement
+  uint16_t ambient;            ///< Raw ambient light measurement
+  uint16_t white;              ///< Raw white light measurement
+  uint16_t proximity_config;   ///< Proximity settings, as `getProximityConfig`
+  uint8_t interrupt_status;    ///< Interrupt status if requested, otherwise 0
+  uint8_t flags;               ///< `VCNL4040_SampleFlag` values for the sample
+  uint8_t ambient_integration; ///< `VCNL4040_AmbientIntegration` in use
+} VCNL4040_Sample;
+
+/**
+ * @brief A proximity calibration from `calibrateProximity`
+ *
+ * Small enough to keep in EEPROM or flash and restore with `begin` or
+ * `applyCalibration` instead of recalibrating at every startup.
+ */
+typedef struct vcnl4040_calibration {
+  uint16_t cancellation;   ///< Crosstalk subtracted from each measurement
+  uint16_t low_threshold;  ///< Proximity low threshold
+  uint16_t high_threshold; ///< Proximity high threshold
+  uint8_t check;           ///< Check byte, rejects blank or corrupt storage
+} VCNL4040_Calibration;
+
+/**
+ * @brief Bus health counters from `getBusStats`
+ *
+ * A transaction is one I2C write or write-then-read. BusIO reports a NACK
+ * the same way as any other bus error, so both are counted as errors.
+ */
+typedef struct vcnl4040_bus_stats {
+  uint32_t transactions; ///< Transactions attempted, including retries
+  uint32_t errors;       ///< Transactions that were NACKed or failed
+  uint32_t retries;      ///< Transactions repeated after an error
+  uint32_t failures;     ///< Register accesses that failed every attempt
+  uint32_t total_us;     ///< Cumulative time spent in transactions
+  uint32_t max_us;       ///< Longest register access, including retries
+  uint32_t cache_hits;   ///< Readings answered by the result cache
+  uint32_t cache_misses; ///< Readings the result cache had to read
+} VCNL4040_BusStats;
+
+/*!
+ *    @brief  A complete sensor configuration for `Adafruit_VCNL4040::begin`,
+ *            built at compile time, for example:
+ *
+ *            constexpr VCNL4040_Config config =
+ *                VCNL4040_Config()
+ *                    .proximityLEDCurrent(VCNL4040_LED_CURRENT_200MA)
+ *                    .proximityThresholds(100, 200);
+ *
+ *            Each setting is folded into the final register values, so
+ *            `begin` writes each configuration register once without reading
+ *            it first. The default configuration matches plain `begin()`:
+ *            proximity, ambient and white light enabled with 16-bit
+ *            proximity measurements and all other settings at their power-on
+ *            defaults. Thresholds are only written if they are set.
+ */
+class VCNL4040_Config {
+public:
+  /*!
+   *    @brief  Creates the default configuration
+   */
+  constexpr VCNL4040_Config()
+      : VCNL4040_Config(0x0000, 0x0800, 0x0000, 0, 0, 0, 0, 0) {}
+
+  /*!
+   *    @brief  Enables or disables proximity measurements
+   *    @param  enable Set to true to enable proximity measurements
+   *    @return The updated configuration
+   */
+  constexpr VCNL4040_Config enableProximity(bool enable) const {
+    return _withPSConfig12(_field(_ps_config_12, 1, 0, !enable));
+  }
+  /*!
+   *    @brief  Enables or disables ambient light measurements
+   *    @param  enable Set to true to enable ambient light measurements
+   *    @return The updated configuration
+   */
+  constexpr VCNL4040_Config enableAmbientLight(bool enable) const {
+    return _withALSConfig(_field(_als_config, 1, 0, !enable));
+  }
+  /*!
+   *    @brief  Enables or disables white light measurements
+   *    @param  enable Set to true to enable white light measurements
+   *    @return The updated configuration
+   */
+  constexpr VCNL4040_Config enableWhiteLight(bool enable) const {
+    return _withPSMS(_field(_ps_ms, 1, 15, !enable));
+  }
+  /*!
+   *    @brief  Sets the ambient light integration time
+   *    @param  integration_time The `VCNL4040_AmbientIntegration` to use
+   *    @return The updated configuration
+   */
+  constexpr VCNL4040_Config
+  ambientIntegrationTime(VCNL4040_AmbientIntegration integration_time) const {
+    return _withALSConfig(_field(_als_config, 2, 6, integration_time));
+  }
+  /*!
+   *    @brief  Sets the proximity integration time
+   *    @param  integration_time The `VCNL4040_ProximityIntegration` to use
+   *    @return The updated configuration
+   */
+  constexpr VCNL4040_Config proximityIntegrationTime(
+      VCNL4040_ProximityIntegration integration_time) const {
+    return _withPSConfig12(_field(_ps_config_12, 3, 1, integration_time));
+  }
+  /*!
+   *    @brief  Sets the proximity LED current
+   *    @param  led_current The `VCNL4040_LEDCurrent` to use
+   *    @return The updated configuration
+   */
+  constexpr VCNL4040_Config
+  proximityLEDCurrent(VCNL4040_LEDCurrent led_current) const {
+    return _withPSMS(_field(_ps_ms, 3, 8, led_current));
+  }
+  /*!
+   *    @brief  Sets the proximity LED duty cycle
+   *    @param  duty_cycle The `VCNL4040_LEDDutyCycle` to use
+   *    @return The updated configuration
+   */
+  constexpr VCNL4040_Config
+  proximityLEDDutyCycle(VCNL4040_LEDDutyCycle duty_cycle) const {
+    return _withPSConfig12(_field(_ps_config_12, 2, 6, duty_cycle));
+  }
+  /*!
+   *    @brief  Sets the proximity measurement resolution
+   *    @param  high_resolution True for 16-bit, false for 12-bit
+   *    @return The updated configuration
+   */
+  constexpr VCNL4040_Config
+  proximityHighResolution(bool high_resolution) const {
+    return _withPSConfig12(_field(_ps_config_12, 1, 11, high_resolution));
+  }
+  /*!
+   *    @brief  Sets the condition for proximity interrupts
+   *    @param  interrupt_condition The `VCNL4040_ProximityType` to use
+   *    @return The updated configuration
+   */
+  constexpr VCNL4040_Config
+  proximityInterrupts(VCNL4040_ProximityType interrupt_condition) const {
+    return _withPSConfig12(_field(_ps_config_12, 2, 8, interrupt_condition));
+  }
+  /*!
+   *    @brief  Enables or disables ambient light interrupts
+   *    @param  enable Set to true to enable ambient light interrupts
+   *    @return The updated configuration
+   */
+  constexpr VCNL4040_Config ambientLightInterrupts(bool enable) const {
+    return _withALSConfig(_field(_als_config, 1, 1, enable));
+  }
+  /*!
+   *    @brief  Sets the ambient light interrupt persistence
+   *    @param  persistence The `VCNL4040_AmbientPersistence` to use
+   *    @return The updated configuration
+   */
+  constexpr VCNL4040_Config
+  ambientPersistence(VCNL4040_AmbientPersistence persistence) const {
+    return _withALSConfig(_field(_als_config, 2, 2, persistence));
+  }
+  /*!
+   *    @brief  Sets the proximity interrupt persistence
+   *    @param  persistence The `VCNL4040_ProximityPersistence` to use
+   *    @return The updated configuration
+   */
+  constexpr VCNL4040_Config
+  proximityPersistence(VCNL4040_ProximityPersistence persistence) const {
+    return _withPSConfig12(_field(_ps_config_12, 2, 4, persistence));
+  }
+  /*!
+   *    @brief  Enables or disables proximity smart persistence
+   *    @param  enable Set to true to enable smart persistence
+   *    @return The updated configuration
+   */
+  constexpr VCNL4040_Config proximitySmartPersistence(bool enable) const {
+    return _withPSMS(_field(_ps_ms, 1, 4, enable));
+  }
+  /*!
+   *    @brief  Sets the number of LED pulses per proximity measurement
+   *    @param  pulses The `VCNL4040_ProximityMultiPulse` to use
+   *    @return The updated configuration
+   */
+  constexpr VCNL4040_Config
+  proximityMultiPulse(VCNL4040_ProximityMultiPulse pulses) const {
+    return _withPSMS(_field(_ps_ms, 2, 5, pulses));
+  }
+  /*!
+   *    @brief  Enables or disables proximity sunlight cancellation
+   *    @param  enable Set to true to enable sunlight cancellation
+   *    @return The updated configuration
+   */
+  constexpr VCNL4040_Config sunlightCancellation(bool enable) const {
+    return _withPSMS(_field(_ps_ms, 1, 0, enable));
+  }
+  /*!
+   *    @brief  Sets the ambient light interrupt thresholds
+   *    @param  low_threshold The ambient light low threshold
+   *    @param  high_threshold The ambient light high threshold
+   *    @return The updated configuration
+   */
+  constexpr VCNL4040_Config
+  ambientLightThresholds(uint16_t low_threshold,
+                         uint16_t high_threshold) const {
+    return VCNL4040_Config(_als_config, _ps_config_12, _ps_ms, low_threshold,
+                           high_threshold, _ps_low_threshold,
+                           _ps_high_threshold, _thresholds | 0x1);
+  }
+  /*!
+   *    @brief  Sets the proximity interrupt thresholds
+   *    @param  low_threshold The proximity low threshold
+   *    @param  high_threshold The proximity high threshold
+   *    @return The updated configuration
+   */
+  constexpr VCNL4040_Config proximityThresholds(uint16_t low_threshold,
+                                                uint16_t high_threshold) const {
+    return VCNL4040_Config(_als_config, _ps_config_12, _ps_ms,
+                           _als_low_threshold, _als_high_threshold,
+                           low_threshold, high_threshold, _thresholds | 0x2);
+  }
+
+  /*!
+   *    @brief  A low-latency presence detection preset. Proximity is
+   *            measured at the 1/40 duty cycle with two LED pulses per
+   *            measurement and sunlight cancellation. Smart persistence
+   *            debounces close and away interrupts over three measurements
+   *            taken back to back as soon as one crosses a threshold, instead
+   *            of waiting a full measurement period for each. Proximity
+   *            thresholds still need to be set, for example by
+   *            `proximityThresholds` or `calibrateProximity`.
+   *    @return The preset configuration, which can be refined further
+   */
+  static constexpr VCNL4040_Config lowLatencyPresence() {
+    return VCNL4040_Config()
+        .proximityLEDDutyCycle(VCNL4040_LED_DUTY_1_40)
+        .proximityIntegrationTime(VCNL4040_PROXIMITY_INTEGRATION_TIME_2T)
+        .proximityMultiPulse(VCNL4040_PROXIMITY_PULSES_2)
+        .proximityPersistence(VCNL4040_PROXIMITY_PERSISTENCE_3)
+        .proximitySmartPersistence(true)
+        .sunlightCancellation(true)
+        .proximityInterrupts(VCNL4040_PROXIMITY_INT_CLOSE_AWAY);
+  }
+
+private:
+  friend class Adafruit_VCNL4040;
+
+  constexpr VCNL4040_Config(uint16_t als_config, uint16_t ps_config_12,
+                            uint16_t ps_ms, uint16_t als_low_threshold,
+                            uint16_t als_high_threshold,
+                            uint16_t ps_low_threshold,
+                            uint16_t ps_high_threshold, uint8_t thresholds)
+      : _als_config(als_config), _ps_config_12(ps_config_12), _ps_ms(ps_ms),
+        _als_low_threshold(als_low_threshold),
+        _als_high_threshold(als_high_threshold),
+        _ps_low_threshold(ps_low_threshold),
+        _ps_high_threshold(ps_high_threshold), _thresholds(thresholds) {}
+
+  constexpr VCNL4040_Config _withALSConfig(uint16_t als_config) const {
+    return VCNL4040_Config(als_config, _ps_config_12, _ps_ms,
+                           _als_low_threshold, _als_high_threshold,
+                           _ps_low_threshold, _ps_high_threshold, _thresholds);
+  }
+  constexpr VCNL4040_Config _withPSConfig12(uint16_t ps_config_12) const {
+    return VCNL4040_Config(_als_config, ps_config_12, _ps_ms,
+                           _als_low_threshold, _als_high_threshold,
+                           _ps_low_threshold, _ps_high_threshold, _thresholds);
+  }
+  constexpr VCNL4040_Config _withPSMS(uint16_t ps_ms) const {
+    return VCNL4040_Config(_als_config, _ps_config_12, ps_ms,
+                           _als_low_threshold, _als_high_threshold,
+                           _ps_low_threshold, _ps_high_threshold, _thresholds);
+  }
+  static constexpr uint16_t _field(uint16_t word, uint8_t bits, uint8_t shift,
+                                   uint16_t value) {
+    return (word & ~(((1 << bits) - 1) << shift)) |
+           ((value << shift) & (((1 << bits) - 1) << shift));
+  }
+
+  uint16_t _als_config;         ///< ALS_CONFIG register value
+  uint16_t _ps_config_12;       ///< PS_CONFIG_12 register value
+  uint16_t _ps_ms;              ///< PS_MS register value
+  uint16_t _als_low_threshold;  ///< ALS_THDL register value
+  uint16_t _als_high_threshold; ///< ALS_THDH register value
+  uint16_t _ps_low_threshold;   ///< PS_THDL register value
+  uint16_t _ps_high_threshold;  ///< PS_THDH register value
+  uint8_t _thresholds;          ///< Bit 0: ALS set, bit 1: PS set
+};
+
+/**
+ * @brief Interrupt event callback
+ *
+ * Registered with `onInterrupt` and called from `serviceInterrupts` with the
+ * event that occurred and, if enabled with `captureInterruptSamples`, the
+ * sample read alongside the interrupt status. Otherwise `sample` is NULL.
+ */
+typedef void (*VCNL4040_InterruptCallback)(VCNL4040_InterruptType event,
+                                           const VCNL4040_Sample *sample);
+
+/**
+ * @brief Operation completion callback
+ *
+ * Registered with `onOperationComplete` and called from `tick` when an
+ * operation finishes, with whether it succeeded.
+ */
+typedef void (*VCNL4040_OperationCallback)(VCNL4040_Operation operation,
+                                           bool success);
+
+/*!
+ *    @brief  Receives every sample read by `Adafruit_VCNL4040::readAll`,
+ *            including those read by `serviceInterrupts` and
+ *            `Adafruit_VCNL4040_SampleRing::service`. Listeners are linked
+ *            into the sensor rather than stored in an array, so any number
+ *            can be added without allocating.
+ */
+class VCNL4040_SampleListener {
+public:
+  /*!
+   *    @brief  Instantiates a new listener, not yet added to a sensor
+   */
+  VCNL4040_SampleListener() : _next_listener(NULL) {}
+
+  /*!
+   *    @brief  Called with each sample, from the `readAll` call that read
+   *            it.
+   *    @param  sample The sample that was read
+   */
+  virtual void onSample(const VCNL4040_Sample *sample) = 0;
+
+private:
+  friend class Adafruit_VCNL4040;
+  VCNL4040_SampleListener *_next_listener; ///< The next listener in the list
+};
+
 /*!
  *    @brief  Class that stores state and functions for interacting with
- *            the VCNL4040 I2C Digital Potentiometer
+ *            the VCNL4040 I2C Digital Potentiometer. Nothing is allocated on
+ *            the heap; an instance's RAM footprint is
+ *            `sizeof(Adafruit_VCNL4040)`.
  */
 class Adafruit_VCNL4040 {
 public:
   Adafruit_VCNL4040();
+  // the public register pointers point into the instance, so a copy would
+  // drive the original's registers
+  Adafruit_VCNL4040(const Adafruit_VCNL4040 &) = delete;
+  Adafruit_VCNL4040 &operator=(const Adafruit_VCNL4040 &) = delete;
   boolean begin(uint8_t i2c_addr = VCNL4040_I2CADDR_DEFAULT,
-                TwoWire *wire = &Wire);
+                TwoWire *wire = &Wire,
+                const VCNL4040_Calibration *calibration = NULL);
+  boolean begin(const VCNL4040_Config &config,
+                uint8_t i2c_addr = VCNL4040_I2CADDR_DEFAULT,
+                TwoWire *wire = &Wire,
+                const VCNL4040_Calibration *calibration = NULL);
   uint16_t getProximity(void);
   uint16_t getAmbientLight(void);
   uint16_t getWhiteLight(void);
   uint16_t getLux(void);
+  uint32_t getWhiteLightMilli(void);
+  uint32_t getMilliLux(void);
+  static uint32_t
+  countsToMilliLux(uint16_t counts,
+                   VCNL4040_AmbientIntegration integration_time);
+  bool readAll(VCNL4040_Sample *sample, bool read_interrupt_status = false);
+  bool readFresh(VCNL4040_Sample *sample, bool read_interrupt_status = false);
+  void addSampleListener(VCNL4040_SampleListener *listener);
+  void removeSampleListener(VCNL4040_SampleListener *listener);
+  void replaySample(const VCNL4040_Sample *sample);
 
   void enableProximity(bool enable);
   void enableAmbientLight(bool enable);
@@ -148,39 +579,215 @@ public:
   uint16_t getAmbientLightLowThreshold(void);
   void setAmbientLightLowThreshold(uint16_t low_threshold);
 
+  bool enableAmbientChangeDetection(bool enable);
+  void setAmbientChangeWindow(uint16_t window, bool percent = false,
+                              uint16_t min_counts = 10);
+  bool rearmAmbientWindow(uint16_t counts);
+
   void enableProximityInterrupts(VCNL4040_ProximityType interrupt_condition);
 
+  void attachInterruptPin(uint8_t pin);
+  void detachInterruptPin(void);
+  /*!
+   *    @brief  Flags that the sensor's INT pin has been asserted. Safe to call
+   *            from an interrupt handler; for use when the INT pin is not
+   *            attached with `attachInterruptPin`.
+   */
+  void handleInterrupt(void) { _interrupt_pending = true; }
+  void onInterrupt(VCNL4040_InterruptType event,
+                   VCNL4040_InterruptCallback callback);
+  void captureInterruptSamples(bool capture);
+  uint8_t serviceInterrupts(void);
+
   uint16_t getProximityLowThreshold(void);
   void setProximityLowThreshold(uint16_t low_threshold);
 
   uint16_t getProximityHighThreshold(void);
   void setProximityHighThreshold(uint16_t high_threshold);
 
+  uint16_t getProximityCancellation(void);
+  void setProximityCancellation(uint16_t cancellation);
+  bool calibrateProximity(VCNL4040_Calibration *calibration,
+                          uint8_t samples = 16, uint16_t margin = 50);
+  bool applyCalibration(const VCNL4040_Calibration *calibration);
+  static bool calibrationValid(const VCNL4040_Calibration *calibration);
+  bool requestProximityCalibration(VCNL4040_Calibration *calibration,
+                                   uint8_t samples = 16, uint16_t margin = 50);
+
+  bool tick(uint32_t now_ms);
+  VCNL4040_OperationStatus getOperationStatus(void);
+  void onOperationComplete(VCNL4040_OperationCallback callback);
+
   VCNL4040_ProximityIntegration getProximityIntegrationTime(void);
   void
   setProximityIntegrationTime(VCNL4040_ProximityIntegration integration_time);
 
   VCNL4040_AmbientIntegration getAmbientIntegrationTime(void);
   void setAmbientIntegrationTime(VCNL4040_AmbientIntegration integration_time);
+  bool
+  requestAmbientIntegrationTime(VCNL4040_AmbientIntegration integration_time);
+  bool ambientSettling(void);
+
+  void enableAmbientAutoRange(bool enable);
+  void setAmbientAutoRangeLimits(uint16_t low_counts, uint16_t high_counts);
+  bool getAutoRangedLux(uint32_t *millilux,
+                        VCNL4040_AmbientIntegration *integration_time);
 
   VCNL4040_LEDCurrent getProximityLEDCurrent(void);
   void setProximityLEDCurrent(VCNL4040_LEDCurrent led_current);
 
   VCNL4040_LEDDutyCycle getProximityLEDDutyCycle(void);
   void setProximityLEDDutyCycle(VCNL4040_LEDDutyCycle duty_cycle);
+  bool setProximityTiming(VCNL4040_LEDDutyCycle duty_cycle,
+                          VCNL4040_ProximityIntegration integration_time);
+  uint32_t getProximityAverageLEDCurrent(void);
 
   bool getProximityHighResolution(void);
   void setProximityHighResolution(bool high_resolution);
 
+  VCNL4040_AmbientPersistence getAmbientPersistence(void);
+  void setAmbientPersistence(VCNL4040_AmbientPersistence persistence);
+
+  VCNL4040_ProximityPersistence getProximityPersistence(void);
+  void setProximityPersistence(VCNL4040_ProximityPersistence persistence);
+
+  bool getProximitySmartPersistence(void);
+  void enableProximitySmartPersistence(bool enable);
+
+  VCNL4040_ProximityMultiPulse getProximityMultiPulse(void);
+  void setProximityMultiPulse(VCNL4040_ProximityMultiPulse pulses);
+
+  uint16_t getProximityConfig(void);
+
+  bool getSunlightCancellation(void);
+  void enableSunlightCancellation(bool enable);
+
+  void enableProximityActiveForce(bool enable);
+  bool getProximityActiveForce(void);
+  bool triggerProximity(void);
+  bool pollProximityResult(uint16_t *proximity);
+
+  uint16_t getProximityMeasurementPeriod(void);
+  uint16_t getAmbientMeasurementPeriod(void);
+  bool proximityDataReady(void);
+  bool ambientDataReady(void);
+
+  void enableResultCache(bool enable);
+
+  void getBusStats(VCNL4040_BusStats *stats);
+  void resetBusStats(void);
+  void setRetryLimit(uint8_t retries);
+  bool lastTransactionOk(void);
+
+  bool applyConfig(const VCNL4040_Config &config);
+  void beginConfigBatch(void);
+  bool commitConfigBatch(void);
+  void discardConfigBatch(void);
+  bool syncConfig(void);
+  bool verifyConfig(void);
+  bool restoreConfig(void);
+
+  // Deprecated, kept for existing sketches until the next major release.
+  // The driver keeps shadow copies of these registers, so call `syncConfig`
+  // after writing through them, or the next setter will undo the write.
   Adafruit_BusIO_Register
       *PS_CONFIG_12, ///< BusIO Register for PS_CONFIG1 and PS_CONFIG2
       *ALS_CONFIG,   ///< BusIO Register for ALS_CONFIG
       *PS_MS;        ///< BusIO Register for PS_MS
 
 private:
-  bool _init(void);
+  bool _init(const VCNL4040_Config &config);
+  bool _readRegister(uint8_t reg, uint16_t *value);
+  bool _readRegisters(const uint8_t *regs, uint16_t *values, uint8_t count);
+  bool _writeRegister(uint8_t reg, uint16_t value);
+  bool _readSample(VCNL4040_Sample *sample, bool read_interrupt_status,
+                   bool fresh_only);
+  bool _cachedReading(uint8_t index, uint16_t *value);
+  void _storeReading(uint8_t index, uint16_t value);
+  uint16_t _readLight(uint8_t index,
+                      VCNL4040_AmbientIntegration *integration_time);
+  bool _transfer(const uint8_t *write_buffer, size_t write_len,
+                 uint8_t *read_buffer, size_t read_len,
+                 bool each_register = false);
+  bool _writeConfigBits(uint8_t reg, uint16_t *shadow, uint8_t bits,
+                        uint8_t shift, uint16_t value);
+  void _notifySampleListeners(const VCNL4040_Sample *sample);
+  void _resetProximityReady(void);
+  void _resetAmbientReady(void);
+  void _resetLightReady(uint8_t index);
+  void _startWait(uint8_t index, uint16_t wait_ms);
+  bool _dataReady(uint8_t index, uint32_t now_ms);
+  bool _ambientSettled(uint32_t now_ms);
+  void _startAmbientSettling(uint16_t old_config);
+  static void _interruptHandler(void);
+  void _autoRange(uint16_t counts);
+  static uint8_t _calibrationCheck(const VCNL4040_Calibration *calibration);
+  bool _finishCalibration(void);
+  void _finishOperation(VCNL4040_Operation operation, bool success);
+
+  Adafruit_I2CDevice _i2c_dev;                    ///< The sensor's I2C device
+  Adafruit_BusIO_Register _als_config_register;   ///< Backs `ALS_CONFIG`
+  Adafruit_BusIO_Register _ps_config_12_register; ///< Backs `PS_CONFIG_12`
+  Adafruit_BusIO_Register _ps_ms_register;        ///< Backs `PS_MS`
+
+  uint16_t _als_config;   ///< Shadow copy of ALS_CONFIG
+  uint16_t _ps_config_12; ///< Shadow copy of PS_CONFIG_12
+  uint16_t _ps_ms;        ///< Shadow copy of PS_MS
+
+  uint32_t _wait_start_ms[3];    ///< When each channel's wait for data began
+  uint16_t _wait_ms[3];          ///< How long each channel's wait lasts
+  uint8_t _data_waiting;         ///< Bit 0: proximity, 1: ambient, 2: white
+  uint32_t _als_settle_start_ms; ///< When the last ALS_IT change was written
+  uint16_t _als_settle_wait_ms;  ///< How long that change takes to settle
+  bool _als_settling;            ///< The ALS_IT change hasn't settled yet
+
+  VCNL4040_InterruptCallback _interrupt_callbacks[5]; ///< Event callbacks
+
+  volatile bool _interrupt_pending; ///< Set when the INT pin is asserted
+  int8_t _interrupt_pin;            ///< Attached INT pin, or -1
+  bool _capture_interrupt_samples;  ///< Read a sample with the status
+  bool _ps_trigger_pending;         ///< A triggered measurement is running
+
+  bool _als_auto_range;    ///< Automatic ALS ranging is enabled
+  uint16_t _als_auto_low;  ///< Step to a longer ALS_IT below this
+  uint16_t _als_auto_high; ///< Step to a shorter ALS_IT at or above this
+
+  bool _als_change_detection;      ///< Ambient change detection is enabled
+  bool _als_change_percent;        ///< The change window is a percentage
+  uint16_t _als_change_window;     ///< Size of the change window
+  uint16_t _als_change_min_window; ///< Smallest percentage window in counts
+  uint16_t _als_thdl;              ///< Last value written to ALS_THDL
+  uint16_t _als_thdh;              ///< Last value written to ALS_THDH
+  uint8_t _als_thresholds_known;   ///< Bit 0: `_als_thdl`, 1: `_als_thdh` set
+
+  bool _config_batch;           ///< Configuration writes are being staged
+  uint16_t _batch_als_config;   ///< ALS_CONFIG when the batch began
+  uint16_t _batch_ps_config_12; ///< PS_CONFIG_12 when the batch began
+  uint16_t _batch_ps_ms;        ///< PS_MS when the batch began
+
+  VCNL4040_SampleListener *_sample_listeners; ///< First listener for readAll
+
+  VCNL4040_OperationCallback _operation_callback; ///< Completion callback
+
+  uint8_t _operation;        ///< The running `VCNL4040_Operation`
+  uint8_t _operation_status; ///< The last `VCNL4040_OperationStatus`
+  bool _als_settle_pending;  ///< `tick` hasn't reported settling yet
+
+  VCNL4040_Calibration *_calibration; ///< Calibration being measured
+  uint32_t _calibration_sum;          ///< Sum of the calibration readings
+  uint16_t _calibration_max;          ///< Largest calibration reading
+  uint16_t _calibration_margin;       ///< Margin for the thresholds
+  uint8_t _calibration_samples;       ///< Readings to take
+  uint8_t _calibration_count;         ///< Readings taken so far
+
+  VCNL4040_BusStats _bus_stats; ///< Bus health counters
+  uint8_t _retry_limit;         ///< Retries after a failed transaction
+  bool _last_transaction_ok;    ///< The last register access succeeded
 
-  Adafruit_I2CDevice *i2c_dev;
+  bool _cache_enabled;           ///< The result cache is enabled
+  uint8_t _cache_valid;          ///< Bit 0: proximity, 1: ambient, 2: white
+  uint16_t _readings[3];         ///< Last proximity, ambient and white reading
+  uint8_t _light_integration[2]; ///< ALS_IT of the last ambient and white
 };
 
 #endif
@@ -0,0 +1,306 @@
+/*!
+ *  @file Adafruit_VCNL4040_Filter.h
+ *
+ * 	Integer smoothing filters for VCNL4040 proximity and ambient light
+ *
+ * 	This is a library for the Adafruit VCNL4040 breakout:
+ * 	https://www.adafruit.com/product/4161
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ *
+ *	BSD license (see license.txt)
+ */
+
+#ifndef _ADAFRUIT_VCNL4040_FILTER_H
+#define _ADAFRUIT_VCNL4040_FILTER_H
+
+#include "Adafruit_VCNL4040.h"
+
+/*!
+ *    @brief  Exponential moving average in fixed point. Each new value is
+ *            weighted 1/2^SHIFT, so larger shifts smooth more and respond
+ *            more slowly.
+ *    @tparam SHIFT The weight of each new value as a power of two, 1 to 8
+ */
+template <uint8_t SHIFT> class VCNL4040_EMAFilter {
+  static_assert(SHIFT >= 1 && SHIFT <= 8, "SHIFT must be from 1 to 8");
+
+public:
+  /*!
+   *    @brief  Instantiates a new filter, which starts from the first value
+   */
+  VCNL4040_EMAFilter() : _accumulator(0), _primed(false) {}
+
+  /*!
+   *    @brief  Adds a value to the average
+   *    @param  value
+   *            The new value, less than 2^23
+   *    @return The updated average
+   */
+  uint32_t update(uint32_t value) {
+    if (!_primed) {
+      _accumulator = value << SHIFT;
+      _primed = true;
+    } else {
+      _accumulator = _accumulator - (_accumulator >> SHIFT) + value;
+    }
+    return get();
+  }
+
+  /*!
+   *    @brief  Gets the current average
+   *    @return The average, rounded to the nearest integer
+   */
+  uint32_t get(void) { return (_accumulator + (1UL << (SHIFT - 1))) >> SHIFT; }
+
+  /*!
+   *    @brief  Forgets the average, so the next value starts a new one
+   */
+  void reset(void) { _primed = false; }
+
+private:
+  uint32_t _accumulator; ///< The average scaled by 2^SHIFT
+  bool _primed;          ///< A value has been added since the last reset
+};
+
+/*!
+ *    @brief  Running median of the last WINDOW values, which rejects single
+ *            spikes without smearing them the way an average does. The
+ *            window is kept sorted, so each update costs at most WINDOW
+ *            moves and no division.
+ *    @tparam WINDOW The number of values, an odd number from 3 to 15
+ */
+template <uint8_t WINDOW> class VCNL4040_MedianFilter {
+  static_assert((WINDOW & 1) && WINDOW >= 3 && WINDOW <= 15,
+                "WINDOW must be an odd number from 3 to 15");
+
+public:
+  /*!
+   *    @brief  Instantiates a new, empty filter
+   */
+  VCNL4040_MedianFilter() : _count(0), _oldest(0) {}
+
+  /*!
+   *    @brief  Adds a value to the window, replacing the oldest once full
+   *    @param  value
+   *            The new value
+   *    @return The median of the values in the window
+   */
+  uint16_t update(uint16_t value) {
+    uint8_t i;
+
+    if (_count == WINDOW) {
+      // take the oldest value out of the sorted copy
+      for (i = 0; _sorted[i] != _history[_oldest]; i++) {
+      }
+      for (; i < WINDOW - 1; i++) {
+        _sorted[i] = _sorted[i + 1];
+      }
+      _count--;
+    }
+    _history[_oldest] = value;
+    _oldest = (_oldest + 1 < WINDOW) ? _oldest + 1 : 0;
+
+    for (i = _count; i > 0 && _sorted[i - 1] > value; i--) {
+      _sorted[i] = _sorted[i - 1];
+    }
+    _sorted[i] = value;
+    _count++;
+    return get();
+  }
+
+  /*!
+   *    @brief  Gets the median of the values in the window
+   *    @return The median, or 0 if the window is empty
+   */
+  uint16_t get(void) { return _count ? _sorted[_count / 2] : 0; }
+
+  /*!
+   *    @brief  Empties the window
+   */
+  void reset(void) {
+    _count = 0;
+    _oldest = 0;
+  }
+
+private:
+  uint16_t _history[WINDOW]; ///< Values in the order they were added
+  uint16_t _sorted[WINDOW];  ///< The same values in ascending order
+  uint8_t _count;            ///< The number of values in the window
+  uint8_t _oldest;           ///< Index in `_history` of the oldest value
+};
+
+/*!
+ *    @brief  Near/far state with separate thresholds for each direction,
+ *            so a reading hovering around one threshold doesn't make the
+ *            state flicker
+ */
+class VCNL4040_Hysteresis {
+public:
+  /*!
+   *    @brief  Instantiates a new detector in the far state
+   *    @param  near_threshold
+   *            Readings at or above this switch to near
+   *    @param  far_threshold
+   *            Readings at or below this switch to far; should be lower
+   *            than `near_threshold`
+   */
+  VCNL4040_Hysteresis(uint16_t near_threshold, uint16_t far_threshold)
+      : _near_threshold(near_threshold), _far_threshold(far_threshold),
+        _near(false) {}
+
+  /*!
+   *    @brief  Updates the state from a reading
+   *    @param  value
+   *            The new reading
+   *    @return True if the state changed
+   */
+  bool update(uint32_t value) {
+    bool near = _near ? (value > _far_threshold) : (value >= _near_threshold);
+
+    if (near == _near) {
+      return false;
+    }
+    _near = near;
+    return true;
+  }
+
+  /*!
+   *    @brief  Gets the current state
+   *    @return True if near, false if far
+   */
+  bool isNear(void) { return _near; }
+
+  /*!
+   *    @brief  Changes the thresholds, keeping the current state
+   *    @param  near_threshold
+   *            Readings at or above this switch to near
+   *    @param  far_threshold
+   *            Readings at or below this switch to far
+   */
+  void setThresholds(uint16_t near_threshold, uint16_t far_threshold) {
+    _near_threshold = near_threshold;
+    _far_threshold = far_threshold;
+  }
+
+private:
+  uint16_t _near_threshold; ///< Switch to near at or above this
+  uint16_t _far_threshold;  ///< Switch to far at or below this
+  bool _near;               ///< The current state
+};
+
+/**
+ * @brief Presence change callback
+ *
+ * Registered with `Adafruit_VCNL4040_Filter::onPresenceChange` and called
+ * with the new state whenever it changes.
+ */
+typedef void (*VCNL4040_PresenceCallback)(bool near);
+
+/*!
+ *    @brief  Filter pipeline fed by a sensor's samples: proximity passes
+ *            through a median, an average and a near/far detector, and
+ *            ambient light through an average in millilux. Add it to a
+ *            sensor with `Adafruit_VCNL4040::addSampleListener`; only samples
+ *            flagged as fresh are used, so reading faster than the sensor
+ *            measures doesn't weight the filters. Uses integer arithmetic
+ *            only and no allocation.
+ *    @tparam MEDIAN_WINDOW The proximity median window, odd from 3 to 15
+ *    @tparam EMA_SHIFT The averaging weight as a power of two, 1 to 8
+ */
+template <uint8_t MEDIAN_WINDOW = 3, uint8_t EMA_SHIFT = 2>
+class Adafruit_VCNL4040_Filter : public VCNL4040_SampleListener {
+public:
+  /*!
+   *    @brief  Instantiates a new filter pipeline
+   *    @param  near_threshold
+   *            Filtered proximity at or above this is near
+   *    @param  far_threshold
+   *            Filtered proximity at or below this is far
+   */
+  Adafruit_VCNL4040_Filter(uint16_t near_threshold, uint16_t far_threshold)
+      : _presence(near_threshold, far_threshold), _callback(NULL) {}
+
+  /*!
+   *    @brief  Passes a sample through the filters
+   *    @param  sample
+   *            The sample to filter
+   */
+  void onSample(const VCNL4040_Sample *sample) {
+    if (sample->flags & VCNL4040_SAMPLE_PROXIMITY_FRESH) {
+      uint16_t median = _proximity_median.update(sample->proximity);
+      uint32_t proximity = _proximity_average.update(median);
+
+      if (_presence.update(proximity) && _callback) {
+        _callback(_presence.isNear());
+      }
+    }
+    if ((sample->flags & VCNL4040_SAMPLE_AMBIENT_FRESH) &&
+        !(sample->flags & VCNL4040_SAMPLE_AMBIENT_SETTLING)) {
+      // convert first, so auto ranging doesn't step the average
+      _ambient_average.update(Adafruit_VCNL4040::countsToMilliLux(
+          sample->ambient,
+          (VCNL4040_AmbientIntegration)sample->ambient_integration));
+    }
+  }
+
+  /*!
+   *    @brief  Gets the filtered proximity
+   *    @return The filtered proximity measurement
+   */
+  uint16_t getProximity(void) { return _proximity_average.get(); }
+
+  /*!
+   *    @brief  Gets the filtered ambient light
+   *    @return The filtered ambient light in millilux
+   */
+  uint32_t getMilliLux(void) { return _ambient_average.get(); }
+
+  /*!
+   *    @brief  Gets whether something is near the sensor
+   *    @return True if near, false if far
+   */
+  bool isNear(void) { return _presence.isNear(); }
+
+  /*!
+   *    @brief  Changes the near and far thresholds
+   *    @param  near_threshold
+   *            Filtered proximity at or above this is near
+   *    @param  far_threshold
+   *            Filtered proximity at or below this is far
+   */
+  void setThresholds(uint16_t near_threshold, uint16_t far_threshold) {
+    _presence.setThresholds(near_threshold, far_threshold);
+  }
+
+  /*!
+   *    @brief  Registers a callback to be run when the near/far state changes
+   *    @param  callback
+   *            The function to call, or NULL to remove the callback
+   */
+  void onPresenceChange(VCNL4040_PresenceCallback callback) {
+    _callback = callback;
+  }
+
+  /*!
+   *    @brief  Empties all of the filters, for example after reconfiguring
+   *            the sensor
+   */
+  void reset(void) {
+    _proximity_median.reset();
+    _proximity_average.reset();
+    _ambient_average.reset();
+  }
+
+private:
+  VCNL4040_MedianFilter<MEDIAN_WINDOW> _proximity_median; ///< Spike filter
+  VCNL4040_EMAFilter<EMA_SHIFT> _proximity_average;       ///< Noise filter
+  VCNL4040_EMAFilter<EMA_SHIFT> _ambient_average;         ///< Millilux filter
+  VCNL4040_Hysteresis _presence;                          ///< Near/far state
+  VCNL4040_PresenceCallback _callback;                    ///< State callback
+};
+
+#endif
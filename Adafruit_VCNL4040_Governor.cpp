@@ -0,0 +1,208 @@
+/*!
+ *  @file Adafruit_VCNL4040_Governor.cpp
+ *
+ * 	Motion-driven proximity duty cycle governor for the VCNL4040
+ *
+ * 	This is a library for the Adafruit VCNL4040 breakout:
+ * 	https://www.adafruit.com/product/4161
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ * 	BSD (see license.txt)
+ */
+
+#include "Adafruit_VCNL4040_Governor.h"
+
+/*!
+ *    @brief  Instantiates a new governor. By default it samples at the 1/40
+ *            duty cycle when proximity rises by 20 or more between readings
+ *            and drops back to 1/320 after 5 seconds without motion, with the
+ *            1T integration time for both.
+ *    @param  sensor
+ *            The sensor to govern
+ */
+Adafruit_VCNL4040_Governor::Adafruit_VCNL4040_Governor(
+    Adafruit_VCNL4040 *sensor)
+    : _sensor(sensor), _motion_threshold(20), _idle_timeout_ms(5000),
+      _last_motion_ms(0), _last_proximity(0), _have_proximity(false),
+      _fast_mode(false) {
+  _fast.duty_cycle = VCNL4040_LED_DUTY_1_40;
+  _fast.integration = VCNL4040_PROXIMITY_INTEGRATION_TIME_1T;
+  _slow.duty_cycle = VCNL4040_LED_DUTY_1_320;
+  _slow.integration = VCNL4040_PROXIMITY_INTEGRATION_TIME_1T;
+}
+
+/**************************************************************************/
+/*!
+    @brief Applies the slow settings and starts watching the sensor's
+           samples. Call after the sensor has been begun.
+    @return True if the slow settings were written successfully
+*/
+/**************************************************************************/
+bool Adafruit_VCNL4040_Governor::begin(void) {
+  _have_proximity = false;
+  _sensor->addSampleListener(this);
+  return _apply(false);
+}
+
+/**************************************************************************/
+/*!
+    @brief Stops watching the sensor's samples, leaving its settings as they
+           are
+*/
+/**************************************************************************/
+void Adafruit_VCNL4040_Governor::end(void) {
+  _sensor->removeSampleListener(this);
+}
+
+/**************************************************************************/
+/*!
+    @brief Sets the proximity settings used while there is motion
+    @param  duty_cycle
+            The LED duty cycle to use
+    @param  integration_time
+            The proximity integration time to use
+*/
+/**************************************************************************/
+void Adafruit_VCNL4040_Governor::setFastMode(
+    VCNL4040_LEDDutyCycle duty_cycle,
+    VCNL4040_ProximityIntegration integration_time) {
+  _fast.duty_cycle = duty_cycle;
+  _fast.integration = integration_time;
+  if (_fast_mode) {
+    _apply(true);
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Sets the proximity settings used once the scene is static
+    @param  duty_cycle
+            The LED duty cycle to use
+    @param  integration_time
+            The proximity integration time to use
+*/
+/**************************************************************************/
+void Adafruit_VCNL4040_Governor::setSlowMode(
+    VCNL4040_LEDDutyCycle duty_cycle,
+    VCNL4040_ProximityIntegration integration_time) {
+  _slow.duty_cycle = duty_cycle;
+  _slow.integration = integration_time;
+  if (!_fast_mode) {
+    _apply(false);
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Sets how much the proximity must change between readings to count
+           as motion. A rise of at least this much switches to the fast
+           settings; a change of this much either way keeps them.
+    @param  threshold
+            The smallest change in raw proximity that is motion
+*/
+/**************************************************************************/
+void Adafruit_VCNL4040_Governor::setMotionThreshold(uint16_t threshold) {
+  _motion_threshold = threshold;
+}
+
+/**************************************************************************/
+/*!
+    @brief Sets how long the scene must be static before dropping back to
+           the slow settings
+    @param  timeout_ms
+            The time without motion in milliseconds
+*/
+/**************************************************************************/
+void Adafruit_VCNL4040_Governor::setIdleTimeout(uint32_t timeout_ms) {
+  _idle_timeout_ms = timeout_ms;
+}
+
+/**************************************************************************/
+/*!
+    @brief Gets whether the fast settings are applied
+    @return True if sampling fast, false if sampling slowly
+*/
+/**************************************************************************/
+bool Adafruit_VCNL4040_Governor::isFast(void) { return _fast_mode; }
+
+/**************************************************************************/
+/*!
+    @brief Gets the proximity sample period of the current settings
+    @return The time between proximity measurements in milliseconds
+*/
+/**************************************************************************/
+uint16_t Adafruit_VCNL4040_Governor::getSamplePeriod(void) {
+  return _sensor->getProximityMeasurementPeriod();
+}
+
+/**************************************************************************/
+/*!
+    @brief Estimates the average proximity LED current of the current
+           settings, using the sensor's `VCNL4040_LEDCurrent`
+    @return The average LED current in microamps
+*/
+/**************************************************************************/
+uint32_t Adafruit_VCNL4040_Governor::getAverageLEDCurrent(void) {
+  return _sensor->getProximityAverageLEDCurrent();
+}
+
+/**************************************************************************/
+/*!
+    @brief Looks for motion in a sample and switches settings if needed.
+           Called by the sensor for each sample read.
+    @param  sample
+            The sample that was read
+*/
+/**************************************************************************/
+void Adafruit_VCNL4040_Governor::onSample(const VCNL4040_Sample *sample) {
+  // a replayed sample says nothing about the sensor's surroundings now
+  if (!(sample->flags & VCNL4040_SAMPLE_PROXIMITY_FRESH) ||
+      (sample->flags & VCNL4040_SAMPLE_REPLAYED)) {
+    return;
+  }
+  uint16_t proximity = sample->proximity;
+  bool approaching = false, moving = false;
+
+  if (_have_proximity) {
+    approaching = proximity >= _last_proximity &&
+                  proximity - _last_proximity >= _motion_threshold;
+    moving = approaching || (_last_proximity > proximity &&
+                             _last_proximity - proximity >= _motion_threshold);
+  }
+  _last_proximity = proximity;
+  _have_proximity = true;
+
+  if (moving) {
+    _last_motion_ms = sample->timestamp;
+  }
+  if (approaching && !_fast_mode) {
+    _apply(true);
+  } else if (_fast_mode && (uint32_t)(sample->timestamp - _last_motion_ms) >=
+                               _idle_timeout_ms) {
+    _apply(false);
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Writes the fast or slow settings to the sensor, with one write
+           since both are in PS_CONFIG_12
+    @param  fast
+            True for the fast settings, false for the slow settings
+    @return True if the settings were written successfully
+*/
+/**************************************************************************/
+bool Adafruit_VCNL4040_Governor::_apply(bool fast) {
+  const governor_mode *mode = fast ? &_fast : &_slow;
+
+  // this runs inside readAll, possibly while the application has a
+  // configuration batch open, so the batch is left alone
+  if (!_sensor->setProximityTiming(mode->duty_cycle, mode->integration)) {
+    return false;
+  }
+  _fast_mode = fast;
+  return true;
+}
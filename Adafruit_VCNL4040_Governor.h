@@ -0,0 +1,68 @@
+/*!
+ *  @file Adafruit_VCNL4040_Governor.h
+ *
+ * 	Motion-driven proximity duty cycle governor for the VCNL4040
+ *
+ * 	This is a library for the Adafruit VCNL4040 breakout:
+ * 	https://www.adafruit.com/product/4161
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ *
+ *	BSD license (see license.txt)
+ */
+
+#ifndef _ADAFRUIT_VCNL4040_GOVERNOR_H
+#define _ADAFRUIT_VCNL4040_GOVERNOR_H
+
+#include "Adafruit_VCNL4040.h"
+
+/*!
+ *    @brief  Class that switches a sensor between a fast proximity sampling
+ *            rate while something is approaching or moving and a slow,
+ *            low-power rate once the scene has been static for a while. It
+ *            watches the samples read by `Adafruit_VCNL4040::readAll`, so
+ *            the application keeps reading the sensor as usual.
+ */
+class Adafruit_VCNL4040_Governor : public VCNL4040_SampleListener {
+public:
+  Adafruit_VCNL4040_Governor(Adafruit_VCNL4040 *sensor);
+  bool begin(void);
+  void end(void);
+
+  void setFastMode(VCNL4040_LEDDutyCycle duty_cycle,
+                   VCNL4040_ProximityIntegration integration_time);
+  void setSlowMode(VCNL4040_LEDDutyCycle duty_cycle,
+                   VCNL4040_ProximityIntegration integration_time);
+  void setMotionThreshold(uint16_t threshold);
+  void setIdleTimeout(uint32_t timeout_ms);
+
+  bool isFast(void);
+  uint16_t getSamplePeriod(void);
+  uint32_t getAverageLEDCurrent(void);
+
+  void onSample(const VCNL4040_Sample *sample);
+
+private:
+  bool _apply(bool fast);
+
+  /// Proximity settings for one sampling rate
+  typedef struct {
+    VCNL4040_LEDDutyCycle duty_cycle;          ///< LED duty cycle
+    VCNL4040_ProximityIntegration integration; ///< Integration time
+  } governor_mode;
+
+  Adafruit_VCNL4040 *_sensor; ///< The governed sensor
+  governor_mode _fast;        ///< Settings while there is motion
+  governor_mode _slow;        ///< Settings once the scene is static
+  uint16_t _motion_threshold; ///< Smallest proximity change that is motion
+  uint32_t _idle_timeout_ms;  ///< Time without motion before slowing down
+  uint32_t _last_motion_ms;   ///< Timestamp of the last sample with motion
+  uint16_t _last_proximity;   ///< The previous fresh proximity reading
+  bool _have_proximity;       ///< `_last_proximity` is valid
+  bool _fast_mode;            ///< The fast settings are applied
+};
+
+#endif
@@ -0,0 +1,244 @@
+/*!
+ *  @file Adafruit_VCNL4040_Group.cpp
+ *
+ * 	Scheduler for many VCNL4040 sensors on multiple I2C buses and muxes
+ *
+ * 	This is a library for the Adafruit VCNL4040 breakout:
+ * 	https://www.adafruit.com/product/4161
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ * 	BSD (see license.txt)
+ */
+
+#include "Adafruit_VCNL4040_Group.h"
+
+/*!
+ *    @brief  Instantiates a new, empty group of VCNL4040 sensors
+ */
+Adafruit_VCNL4040_Group::Adafruit_VCNL4040_Group(void)
+    : _sensor_count(0), _mux_count(0), _mux_switch_count(0) {}
+
+/**************************************************************************/
+/*!
+    @brief Adds a sensor to the group. The sensor should not have been begun;
+           `begin` does that once the sensor's mux channel is selected.
+    @param  sensor
+            The sensor to add
+    @param  wire
+            The bus the sensor, or the mux it is behind, is connected to
+    @param  mux_address
+            The I2C address of the mux the sensor is behind, or
+            `VCNL4040_NO_MUX` if it is connected directly to `wire`
+    @param  mux_channel
+            The mux channel, 0-7, the sensor is connected to
+    @return The index of the sensor within the group, or -1 if the group is
+            full or `mux_channel` is not 0-7
+*/
+/**************************************************************************/
+int8_t Adafruit_VCNL4040_Group::addSensor(Adafruit_VCNL4040 *sensor,
+                                          TwoWire *wire, uint8_t mux_address,
+                                          uint8_t mux_channel) {
+  uint8_t mux = VCNL4040_NO_MUX;
+
+  if (_sensor_count >= VCNL4040_GROUP_MAX_SENSORS || mux_channel > 7) {
+    return -1;
+  }
+
+  if (mux_address != VCNL4040_NO_MUX) {
+    for (uint8_t i = 0; i < _mux_count; i++) {
+      if (_muxes[i].wire == wire && _muxes[i].address == mux_address) {
+        mux = i;
+      }
+    }
+    if (mux == VCNL4040_NO_MUX) {
+      mux = _mux_count++;
+      _muxes[mux].wire = wire;
+      _muxes[mux].address = mux_address;
+      _muxes[mux].channels = 0xFF;
+    }
+  }
+
+  _sensors[_sensor_count].sensor = sensor;
+  _sensors[_sensor_count].wire = wire;
+  _sensors[_sensor_count].mux = mux;
+  _sensors[_sensor_count].mux_channel = mux_channel;
+  return _sensor_count++;
+}
+
+/**************************************************************************/
+/*!
+    @brief Selects each sensor's mux channel in turn and begins the sensor
+    @return True if every sensor was found and initialized
+*/
+/**************************************************************************/
+bool Adafruit_VCNL4040_Group::begin(void) {
+  bool found_all = true;
+
+  for (uint8_t i = 0; i < _sensor_count; i++) {
+    if (!_select(i) || !_sensors[i].sensor->begin(VCNL4040_I2CADDR_DEFAULT,
+                                                   _sensors[i].wire)) {
+      found_all = false;
+    }
+  }
+  return found_all;
+}
+
+/**************************************************************************/
+/*!
+    @brief Reads every sensor that has completed a new measurement since it
+           was last read. The sensors measure continuously and in parallel,
+           so only sensors with fresh data are touched, and only their fresh
+           channels are read. Sensors that can be reached without switching a
+           mux are read first.
+    @param  callback
+            Function called with each sensor's index and sample
+    @return The number of sensors read
+*/
+/**************************************************************************/
+uint8_t Adafruit_VCNL4040_Group::poll(VCNL4040_GroupCallback callback) {
+  bool ready[VCNL4040_GROUP_MAX_SENSORS];
+  uint8_t ready_count = 0, read_count = 0;
+  VCNL4040_Sample sample;
+
+  for (uint8_t i = 0; i < _sensor_count; i++) {
+    ready[i] = _sensors[i].sensor->proximityDataReady() ||
+               _sensors[i].sensor->ambientDataReady();
+    if (ready[i]) {
+      ready_count++;
+    }
+  }
+
+  while (ready_count) {
+    uint8_t next = VCNL4040_NO_MUX;
+
+    for (uint8_t i = 0; i < _sensor_count; i++) {
+      if (ready[i] && (next == VCNL4040_NO_MUX || _isSelected(i))) {
+        next = i;
+        if (_isSelected(i)) {
+          break;
+        }
+      }
+    }
+    ready[next] = false;
+    ready_count--;
+
+    if (_select(next) && _sensors[next].sensor->readFresh(&sample)) {
+      read_count++;
+      if (callback) {
+        callback(next, &sample);
+      }
+    }
+  }
+  return read_count;
+}
+
+/**************************************************************************/
+/*!
+    @brief Gets the number of sensors in the group
+    @return The number of sensors added with `addSensor`
+*/
+/**************************************************************************/
+uint8_t Adafruit_VCNL4040_Group::getSensorCount(void) { return _sensor_count; }
+
+/**************************************************************************/
+/*!
+    @brief Gets one of the sensors in the group. Select it with `poll` or
+           `begin` before using it directly if it is behind a mux.
+    @param  index
+            The index returned by `addSensor`
+    @return The sensor, or NULL if `index` is out of range
+*/
+/**************************************************************************/
+Adafruit_VCNL4040 *Adafruit_VCNL4040_Group::getSensor(uint8_t index) {
+  if (index >= _sensor_count) {
+    return NULL;
+  }
+  return _sensors[index].sensor;
+}
+
+/**************************************************************************/
+/*!
+    @brief Gets the number of times a mux has been switched
+    @return The number of mux channel changes written
+*/
+/**************************************************************************/
+uint32_t Adafruit_VCNL4040_Group::getMuxSwitchCount(void) {
+  return _mux_switch_count;
+}
+
+/**************************************************************************/
+/*!
+    @brief Checks whether a sensor can be reached without switching a mux:
+           its own mux channel is the only one enabled on its bus
+    @param  index
+            The index of the sensor
+    @return True if the sensor is selected
+*/
+/**************************************************************************/
+bool Adafruit_VCNL4040_Group::_isSelected(uint8_t index) {
+  sensor_route *route = &_sensors[index];
+
+  for (uint8_t i = 0; i < _mux_count; i++) {
+    if (_muxes[i].wire != route->wire) {
+      continue;
+    }
+    uint8_t channels = (i == route->mux) ? (1 << route->mux_channel) : 0;
+    if (_muxes[i].channels != channels) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Selects a sensor, disabling every other mux channel on its bus so
+           no other sensor answers at the same address
+    @param  index
+            The index of the sensor
+    @return True if all of the mux writes were successful
+*/
+/**************************************************************************/
+bool Adafruit_VCNL4040_Group::_select(uint8_t index) {
+  sensor_route *route = &_sensors[index];
+
+  // disconnect the other muxes first
+  for (uint8_t i = 0; i < _mux_count; i++) {
+    if (_muxes[i].wire == route->wire && i != route->mux &&
+        _muxes[i].channels != 0 && !_writeMux(i, 0)) {
+      return false;
+    }
+  }
+  if (route->mux != VCNL4040_NO_MUX &&
+      _muxes[route->mux].channels != (1 << route->mux_channel)) {
+    return _writeMux(route->mux, 1 << route->mux_channel);
+  }
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Enables a set of mux channels
+    @param  mux
+            The index of the mux
+    @param  channels
+            Bitmask of the channels to enable
+    @return True if the write was successful
+*/
+/**************************************************************************/
+bool Adafruit_VCNL4040_Group::_writeMux(uint8_t mux, uint8_t channels) {
+  mux_state *state = &_muxes[mux];
+
+  _mux_switch_count++;
+  state->wire->beginTransmission(state->address);
+  state->wire->write(channels);
+  if (state->wire->endTransmission() != 0) {
+    state->channels = 0xFF;
+    return false;
+  }
+  state->channels = channels;
+  return true;
+}
@@ -0,0 +1,83 @@
+/*!
+ *  @file Adafruit_VCNL4040_Group.h
+ *
+ * 	Scheduler for many VCNL4040 sensors on multiple I2C buses and muxes
+ *
+ * 	This is a library for the Adafruit VCNL4040 breakout:
+ * 	https://www.adafruit.com/product/4161
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ *
+ *	BSD license (see license.txt)
+ */
+
+#ifndef _ADAFRUIT_VCNL4040_GROUP_H
+#define _ADAFRUIT_VCNL4040_GROUP_H
+
+#include "Adafruit_VCNL4040.h"
+
+#ifndef VCNL4040_GROUP_MAX_SENSORS
+#define VCNL4040_GROUP_MAX_SENSORS 8 ///< Most sensors a group can manage
+#endif
+
+#define VCNL4040_NO_MUX 0xFF ///< Mux address for a sensor connected directly
+
+/**
+ * @brief Group sample callback
+ *
+ * Called from `Adafruit_VCNL4040_Group::poll` for each sensor that was read,
+ * with the sensor's index as returned by `addSensor` and its sample.
+ */
+typedef void (*VCNL4040_GroupCallback)(uint8_t index,
+                                       const VCNL4040_Sample *sample);
+
+/*!
+ *    @brief  Class that schedules reads from many VCNL4040 sensors, which
+ *            share a fixed I2C address and so are spread across several
+ *            TwoWire buses and TCA9548A-style I2C muxes
+ */
+class Adafruit_VCNL4040_Group {
+public:
+  Adafruit_VCNL4040_Group();
+  int8_t addSensor(Adafruit_VCNL4040 *sensor, TwoWire *wire = &Wire,
+                   uint8_t mux_address = VCNL4040_NO_MUX,
+                   uint8_t mux_channel = 0);
+  bool begin(void);
+  uint8_t poll(VCNL4040_GroupCallback callback);
+
+  uint8_t getSensorCount(void);
+  Adafruit_VCNL4040 *getSensor(uint8_t index);
+  uint32_t getMuxSwitchCount(void);
+
+private:
+  bool _isSelected(uint8_t index);
+  bool _select(uint8_t index);
+  bool _writeMux(uint8_t mux, uint8_t channels);
+
+  /// Routing for one sensor
+  typedef struct {
+    Adafruit_VCNL4040 *sensor; ///< The sensor
+    TwoWire *wire;             ///< The bus the sensor, or its mux, is on
+    uint8_t mux;               ///< Index into `_muxes`, or `VCNL4040_NO_MUX`
+    uint8_t mux_channel;       ///< The mux channel the sensor is on
+  } sensor_route;
+
+  /// State of one mux
+  typedef struct {
+    TwoWire *wire;    ///< The bus the mux is on
+    uint8_t address;  ///< The mux's I2C address
+    uint8_t channels; ///< The channels enabled, or 0xFF if unknown
+  } mux_state;
+
+  sensor_route _sensors[VCNL4040_GROUP_MAX_SENSORS]; ///< Added sensors
+  mux_state _muxes[VCNL4040_GROUP_MAX_SENSORS];      ///< Muxes in use
+
+  uint8_t _sensor_count;      ///< Number of sensors added
+  uint8_t _mux_count;         ///< Number of muxes in use
+  uint32_t _mux_switch_count; ///< Number of writes to the muxes
+};
+
+#endif
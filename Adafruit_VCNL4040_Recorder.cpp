@@ -0,0 +1,346 @@
+/*!
+ *  @file Adafruit_VCNL4040_Recorder.cpp
+ *
+ * 	Compact binary recording and replay of VCNL4040 samples
+ *
+ * 	This is a library for the Adafruit VCNL4040 breakout:
+ * 	https://www.adafruit.com/product/4161
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ * 	BSD (see license.txt)
+ */
+
+#include "Adafruit_VCNL4040_Recorder.h"
+
+// the bytes that start every recording, before the version
+static const uint8_t recording_magic[] = {'V', 'C', 'N'};
+
+/*!
+ *    @brief  Instantiates a new recorder
+ *    @param  sensor
+ *            The sensor whose samples to record
+ *    @param  output
+ *            Where to write the recording
+ */
+Adafruit_VCNL4040_Recorder::Adafruit_VCNL4040_Recorder(
+    Adafruit_VCNL4040 *sensor, Print *output)
+    : _sensor(sensor), _output(output), _config(0), _bytes_written(0) {
+  memset(&_previous, 0, sizeof(_previous));
+}
+
+/**************************************************************************/
+/*!
+    @brief Writes the start of a recording and starts recording every sample
+           read by the sensor's `readAll`
+*/
+/**************************************************************************/
+void Adafruit_VCNL4040_Recorder::begin(void) {
+  _bytes_written = _output->write(recording_magic, sizeof(recording_magic));
+  _bytes_written += _output->write((uint8_t)VCNL4040_RECORDING_VERSION);
+
+  memset(&_previous, 0, sizeof(_previous));
+  _config = _packConfig(_sensor->getAmbientIntegrationTime(),
+                        _sensor->getProximityConfig());
+  _bytes_written += _output->write((uint8_t)VCNL4040_RECORD_CONFIG);
+  _bytes_written += _output->write((uint8_t)(_config & 0xFF));
+  _bytes_written += _output->write((uint8_t)(_config >> 8));
+
+  _sensor->addSampleListener(this);
+}
+
+/**************************************************************************/
+/*!
+    @brief Stops recording
+*/
+/**************************************************************************/
+void Adafruit_VCNL4040_Recorder::end(void) {
+  _sensor->removeSampleListener(this);
+}
+
+/**************************************************************************/
+/*!
+    @brief Gets the size of the recording
+    @return The number of bytes written since `begin`
+*/
+/**************************************************************************/
+uint32_t Adafruit_VCNL4040_Recorder::getBytesWritten(void) {
+  return _bytes_written;
+}
+
+/**************************************************************************/
+/*!
+    @brief Records a sample, preceded by a configuration record if the
+           sensor settings have changed. Called by the sensor for each
+           sample read.
+    @param  sample
+            The sample that was read
+*/
+/**************************************************************************/
+void Adafruit_VCNL4040_Recorder::onSample(const VCNL4040_Sample *sample) {
+  // the sample's own settings, since auto ranging or a listener may already
+  // have changed the sensor's for the next reading
+  uint16_t config =
+      _packConfig(sample->ambient_integration, sample->proximity_config);
+  uint8_t tag = sample->flags & VCNL4040_RECORD_FLAGS;
+
+  if (config != _config) {
+    _config = config;
+    _bytes_written += _output->write((uint8_t)VCNL4040_RECORD_CONFIG);
+    _bytes_written += _output->write((uint8_t)(config & 0xFF));
+    _bytes_written += _output->write((uint8_t)(config >> 8));
+  }
+
+  if (sample->interrupt_status) {
+    tag |= VCNL4040_RECORD_INTERRUPT;
+  }
+  _bytes_written += _output->write(tag);
+  _writeVarint(sample->timestamp - _previous.timestamp);
+  _writeDelta(sample->proximity, _previous.proximity);
+  _writeDelta(sample->ambient, _previous.ambient);
+  _writeDelta(sample->white, _previous.white);
+  if (tag & VCNL4040_RECORD_INTERRUPT) {
+    _bytes_written += _output->write(sample->interrupt_status);
+  }
+  _previous = *sample;
+}
+
+/**************************************************************************/
+/*!
+    @brief Packs the sensor settings that affect its readings into the two
+           bytes of a configuration record
+    @param  ambient_integration
+            The ambient light integration time to record
+    @param  proximity_config
+            The proximity settings to record, as
+            `Adafruit_VCNL4040::getProximityConfig`
+    @return The packed settings
+*/
+/**************************************************************************/
+uint16_t Adafruit_VCNL4040_Recorder::_packConfig(uint8_t ambient_integration,
+                                                uint16_t proximity_config) {
+  return (ambient_integration & 0x3) | ((proximity_config & 0x7FF) << 2);
+}
+
+/**************************************************************************/
+/*!
+    @brief Writes an unsigned integer seven bits at a time, least
+           significant first, with the top bit set on all but the last byte
+    @param  value
+            The value to write
+*/
+/**************************************************************************/
+void Adafruit_VCNL4040_Recorder::_writeVarint(uint32_t value) {
+  while (value >= 0x80) {
+    _bytes_written += _output->write((uint8_t)(value | 0x80));
+    value >>= 7;
+  }
+  _bytes_written += _output->write((uint8_t)value);
+}
+
+/**************************************************************************/
+/*!
+    @brief Writes the change from one reading to the next, zigzag encoded
+           so small changes either way take one byte
+    @param  value
+            The new reading
+    @param  previous
+            The previous reading
+*/
+/**************************************************************************/
+void Adafruit_VCNL4040_Recorder::_writeDelta(uint16_t value,
+                                             uint16_t previous) {
+  int32_t delta = (int32_t)value - previous;
+
+  _writeVarint(((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+}
+
+/*!
+ *    @brief  Instantiates a new replay
+ *    @param  input
+ *            Where to read the recording from
+ */
+Adafruit_VCNL4040_Replay::Adafruit_VCNL4040_Replay(Stream *input)
+    : _input(input), _config(0) {
+  memset(&_previous, 0, sizeof(_previous));
+}
+
+/**************************************************************************/
+/*!
+    @brief Reads and checks the start of a recording
+    @return True if the input holds a recording this version can read
+*/
+/**************************************************************************/
+bool Adafruit_VCNL4040_Replay::begin(void) {
+  for (uint8_t i = 0; i < sizeof(recording_magic); i++) {
+    if (_input->read() != recording_magic[i]) {
+      return false;
+    }
+  }
+  memset(&_previous, 0, sizeof(_previous));
+  _config = 0;
+  return _input->read() == VCNL4040_RECORDING_VERSION;
+}
+
+/**************************************************************************/
+/*!
+    @brief Reads the next sample from the recording, applying any
+           configuration records before it
+    @param  sample
+            Where to store the sample
+    @return True if a sample was read, false at the end of the recording
+*/
+/**************************************************************************/
+bool Adafruit_VCNL4040_Replay::next(VCNL4040_Sample *sample) {
+  uint32_t elapsed_ms;
+  int tag;
+
+  while ((tag = _input->read()) == VCNL4040_RECORD_CONFIG) {
+    int low = _input->read();
+    int high = _input->read();
+
+    if (low < 0 || high < 0) {
+      return false;
+    }
+    _config = low | (high << 8);
+  }
+  if (tag < 0 || !_readVarint(&elapsed_ms) ||
+      !_readDelta(&_previous.proximity) || !_readDelta(&_previous.ambient) ||
+      !_readDelta(&_previous.white)) {
+    return false;
+  }
+  _previous.timestamp += elapsed_ms;
+  _previous.flags = tag & VCNL4040_RECORD_FLAGS;
+  _previous.ambient_integration = _config & 0x3;
+  _previous.proximity_config = _config >> 2;
+  _previous.interrupt_status = 0;
+  if (tag & VCNL4040_RECORD_INTERRUPT) {
+    int interrupt_status = _input->read();
+
+    if (interrupt_status < 0) {
+      return false;
+    }
+    _previous.interrupt_status = interrupt_status;
+  }
+  *sample = _previous;
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Passes every remaining sample in the recording to a sensor's
+           sample listeners with `Adafruit_VCNL4040::replaySample`. The
+           sensor doesn't need to be connected.
+    @param  sensor
+            The sensor whose listeners should receive the samples
+    @return The number of samples replayed
+*/
+/**************************************************************************/
+uint32_t Adafruit_VCNL4040_Replay::replay(Adafruit_VCNL4040 *sensor) {
+  VCNL4040_Sample sample;
+  uint32_t count = 0;
+
+  while (next(&sample)) {
+    sensor->replaySample(&sample);
+    count++;
+  }
+  return count;
+}
+
+/**************************************************************************/
+/*!
+    @brief Gets the recorded proximity integration time
+    @return The integration time of the last sample read
+*/
+/**************************************************************************/
+VCNL4040_ProximityIntegration
+Adafruit_VCNL4040_Replay::getProximityIntegrationTime(void) {
+  return (VCNL4040_ProximityIntegration)((_config >> 2) & 0x7);
+}
+
+/**************************************************************************/
+/*!
+    @brief Gets the recorded proximity LED duty cycle
+    @return The duty cycle of the last sample read
+*/
+/**************************************************************************/
+VCNL4040_LEDDutyCycle Adafruit_VCNL4040_Replay::getProximityLEDDutyCycle(void) {
+  return (VCNL4040_LEDDutyCycle)((_config >> 5) & 0x3);
+}
+
+/**************************************************************************/
+/*!
+    @brief Gets the recorded proximity LED current
+    @return The LED current of the last sample read
+*/
+/**************************************************************************/
+VCNL4040_LEDCurrent Adafruit_VCNL4040_Replay::getProximityLEDCurrent(void) {
+  return (VCNL4040_LEDCurrent)((_config >> 7) & 0x7);
+}
+
+/**************************************************************************/
+/*!
+    @brief Gets the recorded number of LED pulses per proximity measurement
+    @return The multi-pulse setting of the last sample read
+*/
+/**************************************************************************/
+VCNL4040_ProximityMultiPulse
+Adafruit_VCNL4040_Replay::getProximityMultiPulse(void) {
+  return (VCNL4040_ProximityMultiPulse)((_config >> 10) & 0x3);
+}
+
+/**************************************************************************/
+/*!
+    @brief Gets the recorded proximity resolution
+    @return True if the last sample read had 16-bit proximity
+*/
+/**************************************************************************/
+bool Adafruit_VCNL4040_Replay::getProximityHighResolution(void) {
+  return (bool)((_config >> 12) & 0x1);
+}
+
+/**************************************************************************/
+/*!
+    @brief Reads an unsigned integer written by
+           `Adafruit_VCNL4040_Recorder::_writeVarint`
+    @param  value
+            Where to store the value
+    @return True if the value was read, false at the end of the recording
+*/
+/**************************************************************************/
+bool Adafruit_VCNL4040_Replay::_readVarint(uint32_t *value) {
+  *value = 0;
+  for (uint8_t shift = 0; shift < 35; shift += 7) {
+    int byte = _input->read();
+
+    if (byte < 0) {
+      return false;
+    }
+    *value |= (uint32_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**************************************************************************/
+/*!
+    @brief Reads a change written by `Adafruit_VCNL4040_Recorder::_writeDelta`
+           and applies it to a reading
+    @param  value
+            The previous reading, updated to the new one
+    @return True if the change was read, false at the end of the recording
+*/
+/**************************************************************************/
+bool Adafruit_VCNL4040_Replay::_readDelta(uint16_t *value) {
+  uint32_t zigzag;
+
+  if (!_readVarint(&zigzag)) {
+    return false;
+  }
+  *value += (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+  return true;
+}
@@ -0,0 +1,94 @@
+/*!
+ *  @file Adafruit_VCNL4040_Recorder.h
+ *
+ * 	Compact binary recording and replay of VCNL4040 samples
+ *
+ * 	This is a library for the Adafruit VCNL4040 breakout:
+ * 	https://www.adafruit.com/product/4161
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ *
+ *	BSD license (see license.txt)
+ */
+
+#ifndef _ADAFRUIT_VCNL4040_RECORDER_H
+#define _ADAFRUIT_VCNL4040_RECORDER_H
+
+#include "Adafruit_VCNL4040.h"
+
+#define VCNL4040_RECORDING_VERSION 1 ///< Recording format version
+
+#define VCNL4040_RECORD_CONFIG 0x80    ///< Tag of a configuration record
+#define VCNL4040_RECORD_INTERRUPT 0x08 ///< Sample record has interrupt status
+#define VCNL4040_RECORD_FLAGS 0x07     ///< Sample record `flags` bits
+
+/*!
+ *    @brief  Class that records the samples read by a sensor to any `Print`,
+ *            such as `Serial` or an SD card file, in a compact binary format.
+ *
+ *            A recording starts with the bytes 'V', 'C', 'N' and the format
+ *            version, followed by records that each start with a tag byte:
+ *
+ *            - A configuration record, tag `VCNL4040_RECORD_CONFIG`, holds
+ *              the integration times and LED settings as two bytes. One is
+ *              written at the start and whenever the settings change.
+ *            - A sample record has the sample's flags in the tag, then the
+ *              time since the previous sample and the change in proximity,
+ *              ambient and white light as variable length integers, then
+ *              the interrupt status if the tag has
+ *              `VCNL4040_RECORD_INTERRUPT`.
+ *
+ *            A typical sample takes 5 to 7 bytes.
+ */
+class Adafruit_VCNL4040_Recorder : public VCNL4040_SampleListener {
+public:
+  Adafruit_VCNL4040_Recorder(Adafruit_VCNL4040 *sensor, Print *output);
+  void begin(void);
+  void end(void);
+  uint32_t getBytesWritten(void);
+
+  void onSample(const VCNL4040_Sample *sample);
+
+private:
+  uint16_t _packConfig(uint8_t ambient_integration, uint16_t proximity_config);
+  void _writeVarint(uint32_t value);
+  void _writeDelta(uint16_t value, uint16_t previous);
+
+  Adafruit_VCNL4040 *_sensor; ///< The recorded sensor
+  Print *_output;             ///< Where the recording is written
+  VCNL4040_Sample _previous;  ///< The last sample recorded
+  uint16_t _config;           ///< The last configuration recorded
+  uint32_t _bytes_written;    ///< Size of the recording so far
+};
+
+/*!
+ *    @brief  Class that reads back a recording made by
+ *            `Adafruit_VCNL4040_Recorder` from any `Stream`, as fast as the
+ *            stream can be read
+ */
+class Adafruit_VCNL4040_Replay {
+public:
+  Adafruit_VCNL4040_Replay(Stream *input);
+  bool begin(void);
+  bool next(VCNL4040_Sample *sample);
+  uint32_t replay(Adafruit_VCNL4040 *sensor);
+
+  VCNL4040_ProximityIntegration getProximityIntegrationTime(void);
+  VCNL4040_LEDDutyCycle getProximityLEDDutyCycle(void);
+  VCNL4040_LEDCurrent getProximityLEDCurrent(void);
+  VCNL4040_ProximityMultiPulse getProximityMultiPulse(void);
+  bool getProximityHighResolution(void);
+
+private:
+  bool _readVarint(uint32_t *value);
+  bool _readDelta(uint16_t *value);
+
+  Stream *_input;            ///< Where the recording is read from
+  VCNL4040_Sample _previous; ///< The last sample read
+  uint16_t _config;          ///< The last configuration read
+};
+
+#endif
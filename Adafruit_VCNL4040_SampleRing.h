@@ -0,0 +1,226 @@
+/*!
+ *  @file Adafruit_VCNL4040_SampleRing.h
+ *
+ * 	Fixed-size sample buffer for streaming VCNL4040 acquisition
+ *
+ * 	This is a library for the Adafruit VCNL4040 breakout:
+ * 	https://www.adafruit.com/product/4161
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ *
+ *	BSD license (see license.txt)
+ */
+
+#ifndef _ADAFRUIT_VCNL4040_SAMPLERING_H
+#define _ADAFRUIT_VCNL4040_SAMPLERING_H
+
+#include "Adafruit_VCNL4040.h"
+
+/// Keeps the compiler from moving memory accesses across this point
+#define VCNL4040_MEMORY_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+/*!
+ *    @brief  Lock-free single-producer, single-consumer ring of timestamped
+ *            samples. A timer or pin interrupt calls `requestCapture`, which
+ *            only records the time, and `service` in `loop()` reads the
+ *            sample; the consumer (`pop` or `drain`) also runs in `loop()`.
+ *            Alternatively the producer can be an interrupt that calls
+ *            `push` with a sample it already has. Nothing is allocated; when
+ *            the ring is full new samples are dropped and counted.
+ *    @tparam CAPACITY The number of samples held, a power of two up to 128
+ */
+template <uint8_t CAPACITY> class Adafruit_VCNL4040_SampleRing {
+  static_assert(CAPACITY && (CAPACITY & (CAPACITY - 1)) == 0 &&
+                    CAPACITY <= 128,
+                "CAPACITY must be a power of two up to 128");
+
+public:
+  /*!
+   *    @brief  Instantiates a new, empty ring
+   */
+  Adafruit_VCNL4040_SampleRing()
+      : _head(0), _tail(0), _request_overflows(0), _ring_overflows(0),
+        _read_failures(0), _capture_ms(0), _capture_pending(false) {}
+
+  /*!
+   *    @brief  Requests a sample, timestamped now, to be read by the next
+   *            call to `service`. Safe to call from a timer or pin interrupt,
+   *            since it doesn't touch the bus or the sensor's state. A
+   *            request made before the last one was serviced is counted as
+   *            an overflow.
+   */
+  void requestCapture(void) {
+    if (_capture_pending) {
+      _request_overflows++;
+      return;
+    }
+    _capture_ms = millis();
+    VCNL4040_MEMORY_BARRIER();
+    _capture_pending = true;
+  }
+
+  /*!
+   *    @brief  Reads the sample requested by `requestCapture`, if any, and
+   *            adds it to the ring. The sample keeps the time it was read;
+   *            the time of the request is kept alongside it, for `pop` and
+   *            `drain`. A request whose read fails is counted as an
+   *            overflow. Call from `loop()`, not from an interrupt.
+   *    @param  sensor
+   *            The sensor to read
+   *    @param  read_interrupt_status
+   *            Set to true to also read, and so clear, the interrupt status
+   *    @return True if a sample was read and stored
+   */
+  bool service(Adafruit_VCNL4040 *sensor, bool read_interrupt_status = false) {
+    VCNL4040_Sample sample;
+
+    if (!_capture_pending) {
+      return false;
+    }
+    uint32_t capture_ms = _capture_ms;
+    VCNL4040_MEMORY_BARRIER();
+    _capture_pending = false;
+
+    if (!sensor->readAll(&sample, read_interrupt_status)) {
+      _read_failures++;
+      return false;
+    }
+    return _store(sample, capture_ms);
+  }
+
+  /*!
+   *    @brief  Reads a sample from a sensor and adds it to the ring straight
+   *            away. Call from `loop()`, not from an interrupt; `readAll`
+   *            uses the bus and updates state shared with other calls.
+   *    @param  sensor
+   *            The sensor to read
+   *    @param  read_interrupt_status
+   *            Set to true to also read, and so clear, the interrupt status
+   *    @return True if the sample was read and stored
+   */
+  bool capture(Adafruit_VCNL4040 *sensor, bool read_interrupt_status = false) {
+    VCNL4040_Sample sample;
+
+    if (!sensor->readAll(&sample, read_interrupt_status)) {
+      return false;
+    }
+    return push(sample);
+  }
+
+  /*!
+   *    @brief  Adds a sample to the ring, requested at the time it was read.
+   *            Producer side only.
+   *    @param  sample
+   *            The sample to add
+   *    @return True if the sample was stored, false if the ring was full
+   */
+  bool push(const VCNL4040_Sample &sample) {
+    return _store(sample, sample.timestamp);
+  }
+
+  /*!
+   *    @brief  Removes the oldest sample from the ring. Consumer side only.
+   *    @param  sample
+   *            Where to store the sample
+   *    @param  requested_ms
+   *            Where to store the `millis()` the sample was requested at, or
+   *            NULL
+   *    @return True if a sample was removed, false if the ring was empty
+   */
+  bool pop(VCNL4040_Sample *sample, uint32_t *requested_ms = NULL) {
+    return drain(sample, 1, requested_ms) == 1;
+  }
+
+  /*!
+   *    @brief  Removes up to `max_samples` of the oldest samples from the
+   *            ring. Consumer side only.
+   *    @param  samples
+   *            Where to store the samples, oldest first
+   *    @param  max_samples
+   *            The most samples to remove
+   *    @param  requested_ms
+   *            Where to store the `millis()` each sample was requested at, or
+   *            NULL
+   *    @return The number of samples removed
+   */
+  uint8_t drain(VCNL4040_Sample *samples, uint8_t max_samples,
+                uint32_t *requested_ms = NULL) {
+    uint8_t tail = _tail;
+    uint8_t count = _head - tail;
+
+    if (count > max_samples) {
+      count = max_samples;
+    }
+    VCNL4040_MEMORY_BARRIER();
+    for (uint8_t i = 0; i < count; i++) {
+      uint8_t slot = (uint8_t)(tail + i) & (CAPACITY - 1);
+
+      samples[i] = _samples[slot];
+      if (requested_ms) {
+        requested_ms[i] = _requested_ms[slot];
+      }
+    }
+    VCNL4040_MEMORY_BARRIER();
+    _tail = tail + count;
+    return count;
+  }
+
+  /*!
+   *    @brief  Gets the number of samples waiting in the ring
+   *    @return The number of samples that can be removed
+   */
+  uint8_t available(void) { return _head - _tail; }
+
+  /*!
+   *    @brief  Gets the number of samples dropped because the ring was full,
+   *            a capture request was still waiting to be serviced, or a
+   *            requested capture could not be read
+   *    @return The number of dropped samples
+   */
+  uint16_t getOverflowCount(void) {
+    // each counter has a single writer, but an interrupt could land halfway
+    // through reading a 16-bit count
+    noInterrupts();
+    uint16_t overflows = _request_overflows + _ring_overflows + _read_failures;
+    interrupts();
+    return overflows;
+  }
+
+private:
+  /*!
+   *    @brief  Adds a sample to the ring. Producer side only.
+   *    @param  sample
+   *            The sample to add
+   *    @param  requested_ms
+   *            When the sample was requested
+   *    @return True if the sample was stored, false if the ring was full
+   */
+  bool _store(const VCNL4040_Sample &sample, uint32_t requested_ms) {
+    uint8_t head = _head;
+
+    if ((uint8_t)(head - _tail) == CAPACITY) {
+      _ring_overflows++;
+      return false;
+    }
+    _samples[head & (CAPACITY - 1)] = sample;
+    _requested_ms[head & (CAPACITY - 1)] = requested_ms;
+    VCNL4040_MEMORY_BARRIER();
+    _head = head + 1;
+    return true;
+  }
+
+  VCNL4040_Sample _samples[CAPACITY];   ///< Sample storage
+  uint32_t _requested_ms[CAPACITY];     ///< When each sample was requested
+  volatile uint8_t _head;               ///< Count of samples pushed
+  volatile uint8_t _tail;               ///< Count of samples removed
+  volatile uint16_t _request_overflows; ///< Requests made while one waited
+  volatile uint16_t _ring_overflows;    ///< Samples dropped by a full ring
+  volatile uint16_t _read_failures;     ///< Requested samples not read
+  volatile uint32_t _capture_ms;        ///< When the pending capture was asked
+  volatile bool _capture_pending;       ///< `service` has a capture to read
+};
+
+#endif
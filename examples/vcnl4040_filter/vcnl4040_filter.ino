@@ -0,0 +1,40 @@
+#include <Adafruit_VCNL4040.h>
+#include <Adafruit_VCNL4040_Filter.h>
+
+Adafruit_VCNL4040 vcnl4040 = Adafruit_VCNL4040();
+
+// median of 5 readings, then an average weighting each new reading 1/4;
+// near at a filtered proximity of 200 or more, far again at 100 or less
+Adafruit_VCNL4040_Filter<5, 2> filter(200, 100);
+
+void presenceChanged(bool near) {
+  Serial.println(near ? "Near" : "Far");
+}
+
+void setup() {
+  Serial.begin(115200);
+  // Wait until serial port is opened
+  while (!Serial) { delay(1); }
+
+  Serial.println("Adafruit VCNL4040 filter demo");
+
+  if (!vcnl4040.begin()) {
+    Serial.println("Couldn't find VCNL4040 chip");
+    while (1);
+  }
+  Serial.println("Found VCNL4040 chip");
+
+  filter.onPresenceChange(presenceChanged);
+  vcnl4040.addSampleListener(&filter);
+}
+
+void loop() {
+  VCNL4040_Sample sample;
+
+  // every sample read is passed through the filter
+  if (vcnl4040.readAll(&sample)) {
+    Serial.print("Proximity: "); Serial.print(filter.getProximity());
+    Serial.print(", lux: "); Serial.println(filter.getMilliLux() / 1000);
+  }
+  delay(20);
+}
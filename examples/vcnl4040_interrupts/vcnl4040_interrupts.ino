@@ -0,0 +1,39 @@
+#include <Adafruit_VCNL4040.h>
+
+// Connect the VCNL4040 INT pin to this pin
+#define VCNL4040_INT_PIN 2
+
+Adafruit_VCNL4040 vcnl4040 = Adafruit_VCNL4040();
+
+void proximityEvent(VCNL4040_InterruptType event, const VCNL4040_Sample *sample) {
+  Serial.print(event == VCNL4040_PROXIMITY_CLOSE ? "Close" : "Away");
+  Serial.print(", proximity: "); Serial.println(sample->proximity);
+}
+
+void setup() {
+  Serial.begin(115200);
+  // Wait until serial port is opened
+  while (!Serial) { delay(1); }
+
+  Serial.println("Adafruit VCNL4040 interrupt demo");
+
+  if (!vcnl4040.begin()) {
+    Serial.println("Couldn't find VCNL4040 chip");
+    while (1);
+  }
+  Serial.println("Found VCNL4040 chip");
+
+  vcnl4040.setProximityLowThreshold(100);
+  vcnl4040.setProximityHighThreshold(200);
+  vcnl4040.enableProximityInterrupts(VCNL4040_PROXIMITY_INT_CLOSE_AWAY);
+
+  vcnl4040.onInterrupt(VCNL4040_PROXIMITY_CLOSE, proximityEvent);
+  vcnl4040.onInterrupt(VCNL4040_PROXIMITY_AWAY, proximityEvent);
+  vcnl4040.captureInterruptSamples(true);
+  vcnl4040.attachInterruptPin(VCNL4040_INT_PIN);
+}
+
+void loop() {
+  // only talks to the sensor after the INT pin has been asserted
+  vcnl4040.serviceInterrupts();
+}
@@ -0,0 +1,508 @@
+/*!
+ *  @file bench_vcnl4040.cpp
+ *
+ * 	Bus cost benchmark of every public Adafruit_VCNL4040 method, checked
+ * 	against the budgets in bench_budget.csv
+ *
+ * 	Each call is made on a freshly begun sensor, after any setup it needs,
+ * 	and costed in I2C transactions, bytes on the wire and milliseconds
+ * 	blocked in delay(). The results are written as CSV and JSON. A call
+ * 	that costs more than its budget, or has no budget, fails the run.
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Adafruit_VCNL4040.h"
+#include "harness.h"
+
+/*!
+ *    @brief  A call to cost, with any setup it needs first
+ */
+typedef struct bench_case {
+  const char *name;                                  ///< Name in the results
+  void (*setup)(Adafruit_VCNL4040 &, SimVCNL4040 &); ///< Run unmetered
+  void (*call)(Adafruit_VCNL4040 &, SimVCNL4040 &);  ///< Run metered
+} BenchCase;
+
+/*!
+ *    @brief  A budget from bench_budget.csv
+ */
+typedef struct bench_budget {
+  char name[64];         ///< Name of the call
+  uint32_t transactions; ///< Most transactions allowed
+  uint32_t bytes;        ///< Most bytes allowed
+  uint32_t delay_ms;     ///< Most delay allowed
+  bool used;             ///< A case matched it
+} BenchBudget;
+
+#define MAX_BUDGETS 160 ///< Lines read from the budget file
+
+/*!
+ *    @brief  Wraps a statement as a setup or call
+ */
+#define STEP(statement)                                                        \
+  [](Adafruit_VCNL4040 &sensor, SimVCNL4040 &chip) {                           \
+    (void)sensor;                                                              \
+    (void)chip;                                                                \
+    statement;                                                                 \
+  }
+
+/*!
+ *    @brief  A call with no setup
+ */
+#define CALL(name, statement)                                                  \
+  { name, NULL, STEP(statement) }
+
+/*!
+ *    @brief  A call after some setup
+ */
+#define SETUP_CALL(name, setup, statement)                                     \
+  { name, STEP(setup), STEP(statement) }
+
+static VCNL4040_Calibration calibration;
+static VCNL4040_Sample sample;
+
+/*!
+ *    @brief  A listener that ignores samples
+ */
+class NullListener : public VCNL4040_SampleListener {
+public:
+  /*!
+   *    @brief  Ignores a sample
+   *    @param  sample The sample
+   */
+  void onSample(const VCNL4040_Sample *sample) { (void)sample; }
+};
+
+static NullListener listener;
+
+static void onEvent(VCNL4040_InterruptType, const VCNL4040_Sample *) {}
+static void onOperation(VCNL4040_Operation, bool) {}
+
+// an interrupt waiting to be serviced: a close event with its pin flagged
+static void pendCloseInterrupt(Adafruit_VCNL4040 &sensor, SimVCNL4040 &chip) {
+  sensor.attachInterruptPin(2);
+  sensor.setProximityHighThreshold(100);
+  sensor.enableProximityInterrupts(VCNL4040_PROXIMITY_INT_CLOSE);
+  chip.setProximity(500);
+  SimClock::advanceMillis(100);
+  sensor.handleInterrupt();
+}
+
+static const BenchCase cases[] = {
+    CALL("begin", sensor.begin()),
+    CALL("begin (config with thresholds)",
+         sensor.begin(VCNL4040_Config()
+                          .proximityThresholds(100, 200)
+                          .ambientLightThresholds(10, 5000))),
+    SETUP_CALL("begin (calibration)",
+               sensor.calibrateProximity(&calibration, 1),
+               sensor.begin(VCNL4040_I2CADDR_DEFAULT, &Wire, &calibration)),
+
+    CALL("getProximity", sensor.getProximity()),
+    SETUP_CALL("getProximity (cache hit)",
+               sensor.enableResultCache(true);
+               sensor.getProximity(), sensor.getProximity()),
+    CALL("getAmbientLight", sensor.getAmbientLight()),
+    SETUP_CALL("getAmbientLight (settling)",
+               sensor.requestAmbientIntegrationTime(
+                   VCNL4040_AMBIENT_INTEGRATION_TIME_160MS),
+               sensor.getAmbientLight()),
+    CALL("getWhiteLight", sensor.getWhiteLight()),
+    CALL("getLux", sensor.getLux()),
+    SETUP_CALL("getLux (cache hit)",
+               sensor.enableResultCache(true);
+               sensor.getLux(), sensor.getLux()),
+    CALL("getWhiteLightMilli", sensor.getWhiteLightMilli()),
+    CALL("getMilliLux", sensor.getMilliLux()),
+    CALL("countsToMilliLux",
+         Adafruit_VCNL4040::countsToMilliLux(
+             1000, VCNL4040_AMBIENT_INTEGRATION_TIME_80MS)),
+    CALL("readAll", sensor.readAll(&sample)),
+    CALL("readAll (interrupt status)", sensor.readAll(&sample, true)),
+    CALL("readFresh", sensor.readFresh(&sample)),
+    SETUP_CALL("readFresh (proximity due)", sensor.readAll(&sample);
+               SimClock::advanceMillis(
+                   sensor.getProximityMeasurementPeriod()),
+               sensor.readFresh(&sample)),
+    CALL("addSampleListener", sensor.addSampleListener(&listener)),
+    SETUP_CALL("removeSampleListener", sensor.addSampleListener(&listener),
+               sensor.removeSampleListener(&listener)),
+    SETUP_CALL("replaySample", sensor.readAll(&sample),
+               sensor.replaySample(&sample)),
+
+    CALL("enableProximity", sensor.enableProximity(true)),
+    CALL("enableAmbientLight", sensor.enableAmbientLight(true)),
+    CALL("enableWhiteLight", sensor.enableWhiteLight(true)),
+
+    CALL("getInterruptStatus", sensor.getInterruptStatus()),
+    CALL("enableAmbientLightInterrupts",
+         sensor.enableAmbientLightInterrupts(true)),
+    CALL("getAmbientLightHighThreshold",
+         sensor.getAmbientLightHighThreshold()),
+    CALL("setAmbientLightHighThreshold",
+         sensor.setAmbientLightHighThreshold(5000)),
+    CALL("getAmbientLightLowThreshold", sensor.getAmbientLightLowThreshold()),
+    CALL("setAmbientLightLowThreshold",
+         sensor.setAmbientLightLowThreshold(10)),
+    CALL("enableAmbientChangeDetection",
+         sensor.enableAmbientChangeDetection(true)),
+    CALL("setAmbientChangeWindow", sensor.setAmbientChangeWindow(50)),
+    SETUP_CALL("rearmAmbientWindow", sensor.enableAmbientChangeDetection(true),
+               sensor.rearmAmbientWindow(500)),
+    CALL("enableProximityInterrupts",
+         sensor.enableProximityInterrupts(VCNL4040_PROXIMITY_INT_CLOSE_AWAY)),
+
+    CALL("attachInterruptPin", sensor.attachInterruptPin(2)),
+    SETUP_CALL("detachInterruptPin", sensor.attachInterruptPin(2),
+               sensor.detachInterruptPin()),
+    CALL("handleInterrupt", sensor.handleInterrupt()),
+    CALL("onInterrupt",
+         sensor.onInterrupt(VCNL4040_PROXIMITY_CLOSE, onEvent)),
+    CALL("captureInterruptSamples", sensor.captureInterruptSamples(true)),
+    SETUP_CALL("serviceInterrupts (idle)",
+               sensor.attachInterruptPin(2);
+               sensor.serviceInterrupts(), sensor.serviceInterrupts()),
+    CALL("serviceInterrupts (polled without a pin)",
+         sensor.serviceInterrupts()),
+    SETUP_CALL("serviceInterrupts (pending)", pendCloseInterrupt(sensor, chip),
+               sensor.serviceInterrupts()),
+    SETUP_CALL("serviceInterrupts (pending with samples)",
+               sensor.captureInterruptSamples(true);
+               pendCloseInterrupt(sensor, chip), sensor.serviceInterrupts()),
+
+    CALL("getProximityLowThreshold", sensor.getProximityLowThreshold()),
+    CALL("setProximityLowThreshold", sensor.setProximityLowThreshold(100)),
+    CALL("getProximityHighThreshold", sensor.getProximityHighThreshold()),
+    CALL("setProximityHighThreshold", sensor.setProximityHighThreshold(200)),
+    CALL("getProximityCancellation", sensor.getProximityCancellation()),
+    CALL("setProximityCancellation", sensor.setProximityCancellation(20)),
+    CALL("calibrateProximity", sensor.calibrateProximity(&calibration)),
+    SETUP_CALL("applyCalibration", sensor.calibrateProximity(&calibration, 1),
+               sensor.applyCalibration(&calibration)),
+    CALL("calibrationValid",
+         Adafruit_VCNL4040::calibrationValid(&calibration)),
+    CALL("requestProximityCalibration",
+         sensor.requestProximityCalibration(&calibration)),
+
+    CALL("tick (idle)", sensor.tick(millis())),
+    SETUP_CALL("tick (calibration reading)",
+               sensor.requestProximityCalibration(&calibration, 2);
+               SimClock::advanceMillis(100), sensor.tick(millis())),
+    SETUP_CALL("tick (last calibration reading)",
+               sensor.requestProximityCalibration(&calibration, 1);
+               SimClock::advanceMillis(100), sensor.tick(millis())),
+    CALL("getOperationStatus", sensor.getOperationStatus()),
+    CALL("onOperationComplete", sensor.onOperationComplete(onOperation)),
+
+    CALL("getProximityIntegrationTime", sensor.getProximityIntegrationTime()),
+    CALL("setProximityIntegrationTime",
+         sensor.setProximityIntegrationTime(
+             VCNL4040_PROXIMITY_INTEGRATION_TIME_8T)),
+    CALL("getAmbientIntegrationTime", sensor.getAmbientIntegrationTime()),
+    CALL("setAmbientIntegrationTime",
+         sensor.setAmbientIntegrationTime(
+             VCNL4040_AMBIENT_INTEGRATION_TIME_160MS)),
+    CALL("requestAmbientIntegrationTime",
+         sensor.requestAmbientIntegrationTime(
+             VCNL4040_AMBIENT_INTEGRATION_TIME_160MS)),
+    CALL("ambientSettling", sensor.ambientSettling()),
+    CALL("enableAmbientAutoRange", sensor.enableAmbientAutoRange(true)),
+    CALL("setAmbientAutoRangeLimits",
+         sensor.setAmbientAutoRangeLimits(4000, 60000)),
+    SETUP_CALL("getAutoRangedLux",
+               sensor.enableAmbientAutoRange(true);
+               chip.setAmbient(10000); SimClock::advanceMillis(100), {
+      uint32_t millilux;
+      VCNL4040_AmbientIntegration integration_time;
+      sensor.getAutoRangedLux(&millilux, &integration_time);
+    }),
+    SETUP_CALL("getAutoRangedLux (range change)",
+               sensor.enableAmbientAutoRange(true), {
+                 uint32_t millilux;
+                 VCNL4040_AmbientIntegration integration_time;
+                 sensor.getAutoRangedLux(&millilux, &integration_time);
+               }),
+
+    CALL("getProximityLEDCurrent", sensor.getProximityLEDCurrent()),
+    CALL("setProximityLEDCurrent",
+         sensor.setProximityLEDCurrent(VCNL4040_LED_CURRENT_200MA)),
+    CALL("getProximityLEDDutyCycle", sensor.getProximityLEDDutyCycle()),
+    CALL("setProximityLEDDutyCycle",
+         sensor.setProximityLEDDutyCycle(VCNL4040_LED_DUTY_1_320)),
+    CALL("setProximityTiming",
+         sensor.setProximityTiming(VCNL4040_LED_DUTY_1_40,
+                                   VCNL4040_PROXIMITY_INTEGRATION_TIME_2T)),
+    CALL("getProximityAverageLEDCurrent",
+         sensor.getProximityAverageLEDCurrent()),
+    CALL("getProximityHighResolution", sensor.getProximityHighResolution()),
+    CALL("setProximityHighResolution",
+         sensor.setProximityHighResolution(false)),
+    CALL("getAmbientPersistence", sensor.getAmbientPersistence()),
+    CALL("setAmbientPersistence",
+         sensor.setAmbientPersistence(VCNL4040_AMBIENT_PERSISTENCE_4)),
+    CALL("getProximityPersistence", sensor.getProximityPersistence()),
+    CALL("setProximityPersistence",
+         sensor.setProximityPersistence(VCNL4040_PROXIMITY_PERSISTENCE_3)),
+    CALL("getProximitySmartPersistence",
+         sensor.getProximitySmartPersistence()),
+    CALL("enableProximitySmartPersistence",
+         sensor.enableProximitySmartPersistence(true)),
+    CALL("getProximityMultiPulse", sensor.getProximityMultiPulse()),
+    CALL("getProximityConfig", sensor.getProximityConfig()),
+    CALL("setProximityMultiPulse",
+         sensor.setProximityMultiPulse(VCNL4040_PROXIMITY_PULSES_4)),
+    CALL("getSunlightCancellation", sensor.getSunlightCancellation()),
+    CALL("enableSunlightCancellation",
+         sensor.enableSunlightCancellation(true)),
+
+    CALL("enableProximityActiveForce",
+         sensor.enableProximityActiveForce(true)),
+    CALL("getProximityActiveForce", sensor.getProximityActiveForce()),
+    SETUP_CALL("triggerProximity", sensor.enableProximityActiveForce(true),
+               sensor.triggerProximity()),
+    SETUP_CALL("pollProximityResult (in progress)",
+               sensor.enableProximityActiveForce(true);
+               sensor.triggerProximity(), {
+                 uint16_t proximity;
+                 sensor.pollProximityResult(&proximity);
+               }),
+    SETUP_CALL("pollProximityResult (complete)",
+               sensor.enableProximityActiveForce(true);
+               sensor.triggerProximity(); SimClock::advanceMillis(100), {
+                 uint16_t proximity;
+                 sensor.pollProximityResult(&proximity);
+               }),
+
+    CALL("getProximityMeasurementPeriod",
+         sensor.getProximityMeasurementPeriod()),
+    CALL("getAmbientMeasurementPeriod", sensor.getAmbientMeasurementPeriod()),
+    CALL("proximityDataReady", sensor.proximityDataReady()),
+    CALL("ambientDataReady", sensor.ambientDataReady()),
+    CALL("enableResultCache", sensor.enableResultCache(true)),
+
+    CALL("getBusStats", {
+      VCNL4040_BusStats stats;
+      sensor.getBusStats(&stats);
+    }),
+    CALL("resetBusStats", sensor.resetBusStats()),
+    CALL("setRetryLimit", sensor.setRetryLimit(2)),
+    CALL("lastTransactionOk", sensor.lastTransactionOk()),
+
+    CALL("applyConfig", sensor.applyConfig(VCNL4040_Config())),
+    CALL("applyConfig (thresholds)",
+         sensor.applyConfig(VCNL4040_Config()
+                                .proximityThresholds(100, 200)
+                                .ambientLightThresholds(10, 5000))),
+    CALL("beginConfigBatch", sensor.beginConfigBatch()),
+    SETUP_CALL("commitConfigBatch",
+               sensor.beginConfigBatch();
+               sensor.setProximityLEDCurrent(VCNL4040_LED_CURRENT_200MA);
+               sensor.setProximityLEDDutyCycle(VCNL4040_LED_DUTY_1_40);
+               sensor.enableAmbientLightInterrupts(true),
+               sensor.commitConfigBatch()),
+    SETUP_CALL("discardConfigBatch",
+               sensor.beginConfigBatch();
+               sensor.setProximityLEDCurrent(VCNL4040_LED_CURRENT_200MA),
+               sensor.discardConfigBatch()),
+    CALL("syncConfig", sensor.syncConfig()),
+    CALL("verifyConfig", sensor.verifyConfig()),
+    CALL("restoreConfig", sensor.restoreConfig()),
+};
+
+#define CASE_COUNT (sizeof(cases) / sizeof(cases[0])) ///< Number of cases
+
+/*!
+ *    @brief  Costs one case on a freshly begun sensor that has had a second
+ *            to take its first measurements
+ *    @param  bench The case
+ *    @return What the call cost
+ */
+static SimCost run(const BenchCase *bench) {
+  SimSensorRig rig;
+  Adafruit_VCNL4040 sensor;
+
+  rig.chip.setProximity(300);
+  rig.chip.setAmbient(1000);
+  rig.chip.setWhite(1000);
+  sensor.begin();
+  SimClock::advanceMillis(1000);
+  if (bench->setup) {
+    bench->setup(sensor, rig.chip);
+  }
+
+  SimCostMeter meter;
+  bench->call(sensor, rig.chip);
+  SimCost cost = meter.read();
+
+  sensor.detachInterruptPin();
+  return cost;
+}
+
+/*!
+ *    @brief  Reads the budgets
+ *    @param  path The budget file, with the same columns as the CSV output
+ *    @param  budgets Where to store the budgets
+ *    @return The number of budgets read, or -1 if the file can't be read
+ */
+static int readBudgets(const char *path, BenchBudget *budgets) {
+  FILE *file = fopen(path, "r");
+  char line[128];
+  int count = 0;
+
+  if (!file) {
+    return -1;
+  }
+  while (count < MAX_BUDGETS && fgets(line, sizeof(line), file)) {
+    BenchBudget *budget = &budgets[count];
+    if (sscanf(line, "%63[^,],%u,%u,%u", budget->name, &budget->transactions,
+               &budget->bytes, &budget->delay_ms) == 4) {
+      budget->used = false;
+      count++;
+    }
+  }
+  fclose(file);
+  return count;
+}
+
+/*!
+ *    @brief  Checks one result against its budget
+ *    @param  name The call
+ *    @param  cost What it cost
+ *    @param  budgets The budgets
+ *    @param  budget_count The number of budgets
+ *    @return True if the call is within its budget
+ */
+static bool withinBudget(const char *name, const SimCost *cost,
+                         BenchBudget *budgets, int budget_count) {
+  for (int i = 0; i < budget_count; i++) {
+    BenchBudget *budget = &budgets[i];
+    if (strcmp(budget->name, name)) {
+      continue;
+    }
+    budget->used = true;
+    bool ok = true;
+    if (cost->transactions > budget->transactions) {
+      printf("over budget: %s: %u transactions, budget %u\n", name,
+             cost->transactions, budget->transactions);
+      ok = false;
+    }
+    if (cost->bytes > budget->bytes) {
+      printf("over budget: %s: %u bytes, budget %u\n", name, cost->bytes,
+             budget->bytes);
+      ok = false;
+    }
+    if (cost->delay_ms > budget->delay_ms) {
+      printf("over budget: %s: %u ms delay, budget %u\n", name,
+             cost->delay_ms, budget->delay_ms);
+      ok = false;
+    }
+    return ok;
+  }
+  printf("no budget: %s\n", name);
+  return false;
+}
+
+/*!
+ *    @brief  Opens an output file, reporting failure
+ *    @param  path The file, or NULL for none
+ *    @return The open file, or NULL
+ */
+static FILE *openOutput(const char *path) {
+  if (!path) {
+    return NULL;
+  }
+  FILE *file = fopen(path, "w");
+  if (!file) {
+    printf("can't write %s\n", path);
+  }
+  return file;
+}
+
+/*!
+ *    @brief  Runs the benchmark
+ *
+ *            bench_vcnl4040 [--csv FILE] [--json FILE] [--budget FILE]
+ *
+ *    @param  argc The number of arguments
+ *    @param  argv The arguments
+ *    @return 0 if every call is within budget, 1 otherwise
+ */
+int main(int argc, char **argv) {
+  const char *csv_path = NULL;
+  const char *json_path = NULL;
+  const char *budget_path = NULL;
+  static BenchBudget budgets[MAX_BUDGETS];
+  int budget_count = 0;
+  bool ok = true;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--csv")) {
+      csv_path = argv[i + 1];
+    } else if (!strcmp(argv[i], "--json")) {
+      json_path = argv[i + 1];
+    } else if (!strcmp(argv[i], "--budget")) {
+      budget_path = argv[i + 1];
+    }
+  }
+  if (budget_path && (budget_count = readBudgets(budget_path, budgets)) < 0) {
+    printf("can't read %s\n", budget_path);
+    return 1;
+  }
+
+  FILE *csv = openOutput(csv_path);
+  FILE *json = openOutput(json_path);
+  if ((csv_path && !csv) || (json_path && !json)) {
+    return 1;
+  }
+  if (csv) {
+    fprintf(csv, "call,transactions,bytes,delay_ms\n");
+  }
+  if (json) {
+    fprintf(json, "[\n");
+  }
+
+  printf("%-42s %12s %6s %9s\n", "call", "transactions", "bytes",
+         "delay ms");
+  for (size_t i = 0; i < CASE_COUNT; i++) {
+    const BenchCase *bench = &cases[i];
+    SimCost cost = run(bench);
+
+    printf("%-42s %12u %6u %9u\n", bench->name, cost.transactions,
+           cost.bytes, cost.delay_ms);
+    if (csv) {
+      fprintf(csv, "%s,%u,%u,%u\n", bench->name, cost.transactions,
+              cost.bytes, cost.delay_ms);
+    }
+    if (json) {
+      fprintf(json,
+              "  {\"call\": \"%s\", \"transactions\": %u, \"bytes\": %u, "
+              "\"delay_ms\": %u}%s\n",
+              bench->name, cost.transactions, cost.bytes, cost.delay_ms,
+              i + 1 < CASE_COUNT ? "," : "");
+    }
+    if (budget_path && !withinBudget(bench->name, &cost, budgets,
+                                     budget_count)) {
+      ok = false;
+    }
+  }
+
+  if (json) {
+    fprintf(json, "]\n");
+    fclose(json);
+  }
+  if (csv) {
+    fclose(csv);
+  }
+  for (int i = 0; i < budget_count; i++) {
+    if (!budgets[i].used) {
+      printf("budget for a call that isn't benchmarked: %s\n",
+             budgets[i].name);
+      ok = false;
+    }
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+/*!
+ *  @file harness.cpp
+ *
+ * 	Shared pieces of the host test harness: a simulated sensor wired to
+ * 	the default bus, and a meter for what driver calls cost
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#include "harness.h"
+
+/*!
+ *    @brief  Creates a meter, started now
+ */
+SimCostMeter::SimCostMeter(void) { start(); }
+
+/*!
+ *    @brief  Starts measuring from now
+ */
+void SimCostMeter::start(void) {
+  Wire.getStats(&_bus);
+  _delay_us = SimClock::delayMicros();
+  _blocked_us = SimClock::blockedMicros();
+}
+
+/*!
+ *    @brief  Gets the cost since the meter was started
+ *    @return The transactions, bytes and blocking time
+ */
+SimCost SimCostMeter::read(void) {
+  SimBusStats bus;
+  SimCost cost;
+
+  Wire.getStats(&bus);
+  cost.transactions = bus.transactions - _bus.transactions;
+  cost.bytes = bus.bytes - _bus.bytes;
+  cost.delay_ms = (SimClock::delayMicros() - _delay_us) / 1000;
+  cost.blocked_us = SimClock::blockedMicros() - _blocked_us;
+  return cost;
+}
+
+/*!
+ *    @brief  Resets the clock, bus counters and injected bus failures and
+ *            attaches a sensor
+ */
+SimSensorRig::SimSensorRig(void) {
+  SimClock::reset();
+  Wire.resetStats();
+  Wire.failNext(0);
+  Wire.setClock(100000);
+  Wire.attach(&chip, 0x60);
+}
+
+/*!
+ *    @brief  Removes the sensor from the bus
+ */
+SimSensorRig::~SimSensorRig(void) { Wire.detach(&chip); }
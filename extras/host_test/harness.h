@@ -0,0 +1,56 @@
+/*!
+ *  @file harness.h
+ *
+ * 	Shared pieces of the host test harness: a simulated sensor wired to
+ * 	the default bus, and a meter for what driver calls cost
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#ifndef _HOST_TEST_HARNESS_H
+#define _HOST_TEST_HARNESS_H
+
+#include <Wire.h>
+
+#include "sim_vcnl4040.h"
+
+/*!
+ *    @brief  What a stretch of driver code cost on the simulated bus
+ */
+typedef struct sim_cost {
+  uint32_t transactions; ///< STOP-terminated I2C transfers
+  uint32_t bytes;        ///< Address and data bytes on the wire
+  uint32_t delay_ms;     ///< Time blocked in delay()
+  uint32_t blocked_us;   ///< Time blocked in delay() and bus transfers
+} SimCost;
+
+/*!
+ *    @brief  Measures the cost of driver calls: construct or `start` it,
+ *            make the calls, then `read` it
+ */
+class SimCostMeter {
+public:
+  SimCostMeter(void);
+  void start(void);
+  SimCost read(void);
+
+private:
+  SimBusStats _bus;     ///< Bus counts at the start
+  uint64_t _delay_us;   ///< Delay time at the start
+  uint64_t _blocked_us; ///< Blocking time at the start
+};
+
+/*!
+ *    @brief  A simulated VCNL4040 at the default address on the default
+ *            bus, with the virtual clock and counters reset. It is removed
+ *            from the bus when the rig goes out of scope.
+ */
+class SimSensorRig {
+public:
+  SimSensorRig(void);
+  ~SimSensorRig(void);
+
+  SimVCNL4040 chip; ///< The simulated sensor
+};
+
+#endif
@@ -0,0 +1,75 @@
+/*!
+ *  @file sim_clock.cpp
+ *
+ * 	Virtual clock behind the host test harness's millis(), micros() and
+ * 	delay()
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#include "sim_clock.h"
+
+uint64_t SimClock::_now_us = 0;
+uint64_t SimClock::_blocked_us = 0;
+uint64_t SimClock::_delay_us = 0;
+
+/*!
+ *    @brief  Gets the current time
+ *    @return Microseconds since the clock was last reset
+ */
+uint64_t SimClock::micros(void) { return _now_us; }
+
+/*!
+ *    @brief  Lets time pass without anything blocking, as if the sketch
+ *            were off doing other work
+ *    @param  us The time to let pass, in microseconds
+ */
+void SimClock::advance(uint64_t us) { _now_us += us; }
+
+/*!
+ *    @brief  Lets time pass without anything blocking
+ *    @param  ms The time to let pass, in milliseconds
+ */
+void SimClock::advanceMillis(uint32_t ms) { _now_us += (uint64_t)ms * 1000; }
+
+/*!
+ *    @brief  Lets time pass while the caller blocks in delay()
+ *    @param  us The time blocked, in microseconds
+ */
+void SimClock::block(uint64_t us) {
+  _now_us += us;
+  _blocked_us += us;
+  _delay_us += us;
+}
+
+/*!
+ *    @brief  Gets the total time spent blocked in delay() and bus transfers
+ *            since the counters were last reset
+ *    @return The blocking time in microseconds
+ */
+uint64_t SimClock::blockedMicros(void) { return _blocked_us; }
+
+/*!
+ *    @brief  Gets the time spent blocked in delay() alone since the counters
+ *            were last reset
+ *    @return The delay time in microseconds
+ */
+uint64_t SimClock::delayMicros(void) { return _delay_us; }
+
+/*!
+ *    @brief  Zeroes the blocking time counters without moving the clock
+ */
+void SimClock::resetCounters(void) {
+  _blocked_us = 0;
+  _delay_us = 0;
+}
+
+/*!
+ *    @brief  Sets the clock and zeroes the blocking time counters
+ *    @param  start_us The time to start from, in microseconds. A start just
+ *            short of 2^32 ms exercises millis() wrapping.
+ */
+void SimClock::reset(uint64_t start_us) {
+  _now_us = start_us;
+  resetCounters();
+}
@@ -0,0 +1,47 @@
+/*!
+ *  @file sim_clock.h
+ *
+ * 	Virtual clock behind the host test harness's millis(), micros() and
+ * 	delay()
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#ifndef _SIM_CLOCK_H
+#define _SIM_CLOCK_H
+
+#include <stdint.h>
+
+/*!
+ *    @brief  A 64-bit microsecond clock that only moves when told to. Tests
+ *            advance it to let time pass; delay() and bus transfers advance
+ *            it as they would block on hardware, and that blocking time is
+ *            totalled separately.
+ */
+class SimClock {
+public:
+  static uint64_t micros(void);
+  static void advance(uint64_t us);
+  static void advanceMillis(uint32_t ms);
+  static void block(uint64_t us);
+  static uint64_t blockedMicros(void);
+  static uint64_t delayMicros(void);
+  static void resetCounters(void);
+  static void reset(uint64_t start_us = 0);
+
+  /*!
+   *    @brief  Bus time is blocking time too, but not delay() time
+   *    @param  us The time the transfer took, in microseconds
+   */
+  static void busTransfer(uint64_t us) {
+    _now_us += us;
+    _blocked_us += us;
+  }
+
+private:
+  static uint64_t _now_us;     ///< The current time
+  static uint64_t _blocked_us; ///< Time spent blocked in delay() or the bus
+  static uint64_t _delay_us;   ///< Time spent blocked in delay()
+};
+
+#endif
@@ -0,0 +1,247 @@
+/*!
+ *  @file sim_i2c_dev.cpp
+ *
+ * 	Simulated Linux i2c-dev buses, reached through wrapped open, close and
+ * 	ioctl calls
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#include "sim_i2c_dev.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/i2c-dev.h>
+#include <linux/i2c.h>
+#include <stdarg.h>
+#include <string.h>
+#include <sys/ioctl.h>
+
+// fake descriptors start well above any the test process opens itself
+#define SIM_I2C_DEV_FD_BASE 1000
+
+extern "C" {
+int __real_open(const char *path, int flags, ...);
+int __real_close(int fd);
+int __real_ioctl(int fd, unsigned long request, ...);
+int __wrap_open(const char *path, int flags, ...);
+int __wrap_close(int fd);
+int __wrap_ioctl(int fd, unsigned long request, ...);
+}
+
+/*!
+ *    @brief  A device attached to a simulated bus
+ */
+typedef struct sim_i2c_dev_target {
+  const char *device;   ///< Path of the bus's i2c-dev device
+  SimI2CTarget *target; ///< The simulated device
+  uint8_t address;      ///< Its 7-bit address
+  bool open;            ///< The bus is open through this entry's descriptor
+} SimI2CDevTarget;
+
+static SimI2CDevTarget targets[SIM_I2C_DEV_TARGETS];
+static uint8_t target_count = 0;
+static uint32_t ioctl_count = 0;
+static uint32_t message_count = 0;
+static uint16_t fail_next = 0;
+
+/*!
+ *    @brief  Attaches a simulated device to a simulated bus, creating the
+ *            bus's device path
+ *    @param  device The path of the bus, e.g. /dev/i2c-1
+ *    @param  target The simulated device
+ *    @param  address Its 7-bit address
+ *    @return True if there was room for the device
+ */
+bool simI2CDevAttach(const char *device, SimI2CTarget *target,
+                     uint8_t address) {
+  if (target_count >= SIM_I2C_DEV_TARGETS) {
+    return false;
+  }
+  targets[target_count].device = device;
+  targets[target_count].target = target;
+  targets[target_count].address = address;
+  targets[target_count].open = false;
+  target_count++;
+  return true;
+}
+
+/*!
+ *    @brief  Removes every simulated bus and device and clears the counters
+ */
+void simI2CDevReset(void) {
+  target_count = 0;
+  ioctl_count = 0;
+  message_count = 0;
+  fail_next = 0;
+}
+
+/*!
+ *    @brief  Makes the next transactions fail, as a NACK of the first
+ *            message
+ *    @param  transactions The number of I2C_RDWR ioctls to fail
+ */
+void simI2CDevFailNext(uint16_t transactions) { fail_next = transactions; }
+
+/*!
+ *    @brief  Gets the number of I2C_RDWR ioctls run, each one transaction
+ *    @return The number of ioctls
+ */
+uint32_t simI2CDevIoctls(void) { return ioctl_count; }
+
+/*!
+ *    @brief  Gets the number of messages carried by the I2C_RDWR ioctls
+ *    @return The number of messages
+ */
+uint32_t simI2CDevMessages(void) { return message_count; }
+
+/*!
+ *    @brief  Checks whether a simulated bus is open
+ *    @param  device The path of the bus
+ *    @return True if it has been opened and not closed
+ */
+bool simI2CDevOpen(const char *device) {
+  for (uint8_t i = 0; i < target_count; i++) {
+    if (targets[i].open && strcmp(targets[i].device, device) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/*!
+ *    @brief  Finds the first device attached to a bus, whose index is the
+ *            bus's fake descriptor
+ *    @param  device The path of the bus
+ *    @return The index of the device, or -1 if the path isn't simulated
+ */
+static int findBus(const char *device) {
+  for (uint8_t i = 0; i < target_count; i++) {
+    if (strcmp(targets[i].device, device) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/*!
+ *    @brief  Finds the bus open on a fake descriptor
+ *    @param  fd The descriptor
+ *    @return The index of the bus's first device, or -1 if `fd` isn't a
+ *            simulated bus
+ */
+static int findOpenBus(int fd) {
+  int index = fd - SIM_I2C_DEV_FD_BASE;
+
+  if (index < 0 || index >= target_count || !targets[index].open) {
+    return -1;
+  }
+  return index;
+}
+
+/*!
+ *    @brief  Runs one I2C_RDWR transaction on a simulated bus. As in the
+ *            kernel, the transaction stops at the first message that
+ *            isn't ACKed.
+ *    @param  bus The index of the bus's first device
+ *    @param  transaction The messages
+ *    @return The number of messages run, or -1 with errno set
+ */
+static int runTransaction(int bus, struct i2c_rdwr_ioctl_data *transaction) {
+  if (transaction->nmsgs == 0 ||
+      transaction->nmsgs > I2C_RDWR_IOCTL_MAX_MSGS) {
+    errno = EINVAL;
+    return -1;
+  }
+  ioctl_count++;
+  message_count += transaction->nmsgs;
+  if (fail_next) {
+    fail_next--;
+    errno = ENXIO;
+    return -1;
+  }
+
+  for (uint32_t m = 0; m < transaction->nmsgs; m++) {
+    struct i2c_msg *message = &transaction->msgs[m];
+    SimI2CTarget *target = NULL;
+
+    for (uint8_t i = 0; i < target_count; i++) {
+      if (strcmp(targets[i].device, targets[bus].device) == 0 &&
+          targets[i].address == message->addr) {
+        target = targets[i].target;
+      }
+    }
+    bool acked = target && ((message->flags & I2C_M_RD)
+                                ? target->i2cRead(message->buf, message->len)
+                                : target->i2cWrite(message->buf, message->len));
+    if (!acked) {
+      errno = ENXIO;
+      return -1;
+    }
+  }
+  return transaction->nmsgs;
+}
+
+/*!
+ *    @brief  Opens a simulated bus, or passes the call to the C library
+ *    @param  path The path to open
+ *    @param  flags The open flags
+ *    @return A fake descriptor for a simulated bus, otherwise as open()
+ */
+int __wrap_open(const char *path, int flags, ...) {
+  int bus = findBus(path);
+  mode_t mode = 0;
+
+  if (bus >= 0) {
+    targets[bus].open = true;
+    return SIM_I2C_DEV_FD_BASE + bus;
+  }
+  if (flags & O_CREAT) {
+    va_list args;
+
+    va_start(args, flags);
+    mode = va_arg(args, mode_t);
+    va_end(args);
+  }
+  return __real_open(path, flags, mode);
+}
+
+/*!
+ *    @brief  Closes a simulated bus, or passes the call to the C library
+ *    @param  fd The descriptor to close
+ *    @return 0, or as close()
+ */
+int __wrap_close(int fd) {
+  int bus = findOpenBus(fd);
+
+  if (bus >= 0) {
+    targets[bus].open = false;
+    return 0;
+  }
+  return __real_close(fd);
+}
+
+/*!
+ *    @brief  Runs an I2C_RDWR transaction on a simulated bus, or passes the
+ *            call to the C library
+ *    @param  fd The descriptor
+ *    @param  request The ioctl request
+ *    @return The number of messages run, or as ioctl()
+ */
+int __wrap_ioctl(int fd, unsigned long request, ...) {
+  int bus = findOpenBus(fd);
+  va_list args;
+
+  va_start(args, request);
+  void *argument = va_arg(args, void *);
+  va_end(args);
+
+  if (bus < 0) {
+    return __real_ioctl(fd, request, argument);
+  }
+  if (request != I2C_RDWR) {
+    errno = ENOTTY;
+    return -1;
+  }
+  return runTransaction(bus, (struct i2c_rdwr_ioctl_data *)argument);
+}
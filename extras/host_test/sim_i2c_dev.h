@@ -0,0 +1,28 @@
+/*!
+ *  @file sim_i2c_dev.h
+ *
+ * 	Simulated Linux i2c-dev buses for testing the Linux port in extras/linux
+ * 	without hardware. The test is linked with -Wl,--wrap for open, close and
+ * 	ioctl, so opening an attached device path returns a fake descriptor and
+ * 	I2C_RDWR ioctls on it are run against the simulated devices. Every
+ * 	other call goes to the C library.
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#ifndef _SIM_I2C_DEV_H
+#define _SIM_I2C_DEV_H
+
+#include "sim_i2c_target.h"
+
+#define SIM_I2C_DEV_TARGETS 8 ///< Devices that can be attached, on all buses
+
+bool simI2CDevAttach(const char *device, SimI2CTarget *target,
+                     uint8_t address);
+void simI2CDevReset(void);
+void simI2CDevFailNext(uint16_t transactions);
+uint32_t simI2CDevIoctls(void);
+uint32_t simI2CDevMessages(void);
+bool simI2CDevOpen(const char *device);
+
+#endif
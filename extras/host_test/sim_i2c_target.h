@@ -0,0 +1,48 @@
+/*!
+ *  @file sim_i2c_target.h
+ *
+ * 	Interface of the simulated devices on the host test harness's buses
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#ifndef _SIM_I2C_TARGET_H
+#define _SIM_I2C_TARGET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*!
+ *    @brief  A simulated I2C device, reached through the simulated `TwoWire`
+ *            bus or the i2c-dev shim
+ */
+class SimI2CTarget {
+public:
+  virtual ~SimI2CTarget() {}
+  /*!
+   *    @brief  Receives the bytes written in one transfer
+   *    @param  data The bytes written
+   *    @param  len The number of bytes written
+   *    @return True to ACK every byte, false to NACK the transfer
+   */
+  virtual bool i2cWrite(const uint8_t *data, size_t len) = 0;
+  /*!
+   *    @brief  Supplies the bytes read in one transfer
+   *    @param  data Where to put the bytes read
+   *    @param  len The number of bytes read
+   *    @return True to ACK the address, false to NACK the transfer
+   */
+  virtual bool i2cRead(uint8_t *data, size_t len) = 0;
+  /*!
+   *    @brief  Checks whether a mux channel is connected to the bus. Only
+   *            muxes have channels.
+   *    @param  channel The channel, 0-7
+   *    @return True if the channel is selected
+   */
+  virtual bool channelSelected(uint8_t channel) {
+    (void)channel;
+    return false;
+  }
+};
+
+#endif
@@ -0,0 +1,402 @@
+/*!
+ *  @file sim_vcnl4040.cpp
+ *
+ * 	Register-level model of the VCNL4040 for the host test harness
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#include "sim_vcnl4040.h"
+
+// command codes, as in Adafruit_VCNL4040.h but kept apart so the model
+// doesn't lean on the driver it is testing
+#define ALS_CONF 0x00
+#define ALS_THDH 0x01
+#define ALS_THDL 0x02
+#define PS_CONF12 0x03
+#define PS_CONF3_MS 0x04
+#define PS_CANC 0x05
+#define PS_THDL 0x06
+#define PS_THDH 0x07
+#define PS_DATA 0x08
+#define ALS_DATA 0x09
+#define WHITE_DATA 0x0A
+#define INT_FLAG 0x0B
+#define DEVICE_ID 0x0C
+
+// INT_FLAG bits
+#define PS_IF_AWAY (1 << 8)
+#define PS_IF_CLOSE (1 << 9)
+#define ALS_IF_H (1 << 12)
+#define ALS_IF_L (1 << 13)
+
+// measurements caught up one at a time before the rest are skipped; enough
+// for any persistence count, with the scene held constant in between
+#define CATCH_UP_LIMIT 16
+
+// PS_IT in half multiples of T, from the datasheet
+static const uint8_t ps_half_t[] = {2, 3, 4, 5, 6, 7, 8, 16};
+
+// counts consecutive readings past a threshold, saturating
+static uint8_t persist(uint8_t count, bool crossed) {
+  if (!crossed) {
+    return 0;
+  }
+  return count < 0xFF ? count + 1 : count;
+}
+
+/*!
+ *    @brief  Creates a sensor at power on, with a dark, empty scene
+ */
+SimVCNL4040::SimVCNL4040(void)
+    : _scene_proximity(0), _scene_ambient(0), _scene_white(0) {
+  reset();
+}
+
+/*!
+ *    @brief  Returns every register to its power-on value, with both
+ *            sensors shut down. The scene is kept.
+ */
+void SimVCNL4040::reset(void) {
+  memset(_registers, 0, sizeof(_registers));
+  _registers[ALS_CONF] = 0x0001;
+  _registers[PS_CONF12] = 0x0001;
+  _registers[DEVICE_ID] = 0x0186;
+  _command = 0;
+  _ps_running = false;
+  _ps_next_us = 0;
+  _ps_one_shot = false;
+  _als_running = false;
+  _als_next_us = 0;
+  _als_it = 0;
+  _ps_close = false;
+  _ps_close_count = 0;
+  _ps_away_count = 0;
+  _als_high_count = 0;
+  _als_low_count = 0;
+  _ps_measured = 0;
+  _als_measured = 0;
+}
+
+/*!
+ *    @brief  Sets what the proximity sensor sees from now on
+ *    @param  counts The reading before cancellation is subtracted
+ */
+void SimVCNL4040::setProximity(uint16_t counts) {
+  _update();
+  _scene_proximity = counts;
+}
+
+/*!
+ *    @brief  Sets what the ambient light sensor sees from now on
+ *    @param  counts The reading at the 80 ms integration time, 0.1 lux each
+ */
+void SimVCNL4040::setAmbient(uint32_t counts) {
+  _update();
+  _scene_ambient = counts;
+}
+
+/*!
+ *    @brief  Sets what the white light sensor sees from now on
+ *    @param  counts The reading at the 80 ms integration time
+ */
+void SimVCNL4040::setWhite(uint32_t counts) {
+  _update();
+  _scene_white = counts;
+}
+
+/*!
+ *    @brief  Changes the ID reported, to pose as another chip
+ *    @param  id The value of the device ID register
+ */
+void SimVCNL4040::setDeviceID(uint16_t id) { _registers[DEVICE_ID] = id; }
+
+/*!
+ *    @brief  Looks at a register without the side effects of reading it
+ *    @param  command The register's command code
+ *    @return The register's value
+ */
+uint16_t SimVCNL4040::peek(uint8_t command) {
+  _update();
+  return command < SIM_VCNL4040_REGISTERS ? _registers[command] : 0;
+}
+
+/*!
+ *    @brief  Sets a register without the side effects of writing it, as a
+ *            brownout or glitch might
+ *    @param  command The register's command code
+ *    @param  value The register's new value
+ */
+void SimVCNL4040::poke(uint8_t command, uint16_t value) {
+  _update();
+  if (command < SIM_VCNL4040_REGISTERS) {
+    _registers[command] = value;
+  }
+}
+
+/*!
+ *    @brief  Checks the INT pin, which is asserted while any interrupt flag
+ *            is set
+ *    @return True if the pin is asserted
+ */
+bool SimVCNL4040::interruptAsserted(void) {
+  _update();
+  return _registers[INT_FLAG] != 0;
+}
+
+/*!
+ *    @brief  Gets the number of proximity measurements completed
+ *    @return The count since the last reset
+ */
+uint32_t SimVCNL4040::proximityMeasurements(void) {
+  _update();
+  return _ps_measured;
+}
+
+/*!
+ *    @brief  Gets the number of ambient light measurements completed
+ *    @return The count since the last reset
+ */
+uint32_t SimVCNL4040::ambientMeasurements(void) {
+  _update();
+  return _als_measured;
+}
+
+/*!
+ *    @brief  Handles a write: a command code, then optionally the low and
+ *            high bytes to store. An empty write is an address probe.
+ *    @param  data The bytes written
+ *    @param  len The number of bytes written
+ *    @return False, a NACK, for a command code the chip doesn't have
+ */
+bool SimVCNL4040::i2cWrite(const uint8_t *data, size_t len) {
+  _update();
+  if (len == 0) {
+    return true;
+  }
+  if (data[0] >= SIM_VCNL4040_REGISTERS) {
+    return false;
+  }
+  _command = data[0];
+  if (len == 2) {
+    _write(_command, (_registers[_command] & 0xFF00) | data[1]);
+  } else if (len > 2) {
+    _write(_command, data[1] | (data[2] << 8));
+  }
+  return true;
+}
+
+/*!
+ *    @brief  Handles a read of the register last given a command code, low
+ *            byte first. Reading INT_FLAG clears it.
+ *    @param  data Where to put the bytes read
+ *    @param  len The number of bytes read; past two they read as 0xFF
+ *    @return True
+ */
+bool SimVCNL4040::i2cRead(uint8_t *data, size_t len) {
+  _update();
+  uint16_t value = _registers[_command];
+
+  memset(data, 0xFF, len);
+  if (len > 0) {
+    data[0] = value & 0xFF;
+  }
+  if (len > 1) {
+    data[1] = value >> 8;
+  }
+  if (_command == INT_FLAG && len > 1) {
+    _registers[INT_FLAG] = 0;
+  }
+  return true;
+}
+
+/*!
+ *    @brief  Completes every measurement due by the current virtual time
+ */
+void SimVCNL4040::_update(void) {
+  uint64_t now_us = SimClock::micros();
+  uint8_t measured = 0;
+
+  while (_ps_running && _ps_next_us <= now_us) {
+    _measureProximity();
+    if (_ps_one_shot) {
+      _ps_running = false;
+      break;
+    }
+    uint64_t period_us = _proximityPeriod();
+    _ps_next_us += period_us;
+    if (++measured == CATCH_UP_LIMIT && _ps_next_us <= now_us) {
+      _ps_next_us += (now_us - _ps_next_us) / period_us * period_us;
+    }
+  }
+
+  measured = 0;
+  while (_als_running && _als_next_us <= now_us) {
+    _measureAmbient();
+    // a new ALS_IT is picked up at the start of the next measurement
+    _als_it = (_registers[ALS_CONF] >> 6) & 0x3;
+    uint64_t period_us = _ambientPeriod();
+    _als_next_us += period_us;
+    if (++measured == CATCH_UP_LIMIT && _als_next_us <= now_us) {
+      _als_next_us += (now_us - _als_next_us) / period_us * period_us;
+    }
+  }
+}
+
+/*!
+ *    @brief  Stores a register, starting or stopping measurements as the
+ *            configuration says
+ *    @param  command The register's command code
+ *    @param  value The value written
+ */
+void SimVCNL4040::_write(uint8_t command, uint16_t value) {
+  uint64_t now_us = SimClock::micros();
+  uint16_t old = _registers[command];
+
+  switch (command) {
+  case PS_DATA:
+  case ALS_DATA:
+  case WHITE_DATA:
+  case INT_FLAG:
+  case DEVICE_ID:
+    // read only
+    return;
+
+  case ALS_CONF:
+    _registers[ALS_CONF] = value;
+    if ((old & 0x1) && !(value & 0x1)) {
+      _als_running = true;
+      _als_it = (value >> 6) & 0x3;
+      _als_next_us = now_us + _ambientPeriod();
+    } else if (value & 0x1) {
+      _als_running = false;
+    }
+    return;
+
+  case PS_CONF12:
+    _registers[PS_CONF12] = value;
+    if (value & 0x1) {
+      _ps_running = false;
+    } else if ((old & 0x1) && !(_registers[PS_CONF3_MS] & (1 << 3))) {
+      _ps_running = true;
+      _ps_one_shot = false;
+      _ps_next_us = now_us + _proximityPeriod();
+    }
+    return;
+
+  case PS_CONF3_MS: {
+    bool active_force = value & (1 << 3);
+    bool enabled = !(_registers[PS_CONF12] & 0x1);
+
+    // PS_TRIG clears itself once the measurement starts
+    _registers[PS_CONF3_MS] = value & ~(1 << 2);
+    if (active_force && (value & (1 << 2)) && enabled) {
+      _ps_running = true;
+      _ps_one_shot = true;
+      _ps_next_us = now_us + _proximityIntegration();
+    } else if (active_force && !(old & (1 << 3))) {
+      _ps_running = false;
+    } else if (!active_force && (old & (1 << 3)) && enabled) {
+      _ps_running = true;
+      _ps_one_shot = false;
+      _ps_next_us = now_us + _proximityPeriod();
+    }
+    return;
+  }
+
+  default:
+    _registers[command] = value;
+    return;
+  }
+}
+
+/*!
+ *    @brief  Completes a proximity measurement, raising close and away
+ *            interrupts once enough readings in a row cross a threshold
+ */
+void SimVCNL4040::_measureProximity(void) {
+  uint16_t config = _registers[PS_CONF12];
+  uint16_t cancellation = _registers[PS_CANC];
+  uint16_t reading =
+      _scene_proximity > cancellation ? _scene_proximity - cancellation : 0;
+
+  if (!(config & (1 << 11)) && reading > 0x0FFF) {
+    reading = 0x0FFF;
+  }
+  _registers[PS_DATA] = reading;
+  _ps_measured++;
+
+  uint8_t persistence = ((config >> 4) & 0x3) + 1;
+  uint8_t interrupts = (config >> 8) & 0x3;
+
+  _ps_close_count = persist(_ps_close_count, reading > _registers[PS_THDH]);
+  _ps_away_count = persist(_ps_away_count, reading < _registers[PS_THDL]);
+  if (!_ps_close && _ps_close_count >= persistence) {
+    _ps_close = true;
+    if (interrupts & 0x1) {
+      _registers[INT_FLAG] |= PS_IF_CLOSE;
+    }
+  } else if (_ps_close && _ps_away_count >= persistence) {
+    _ps_close = false;
+    if (interrupts & 0x2) {
+      _registers[INT_FLAG] |= PS_IF_AWAY;
+    }
+  }
+}
+
+/*!
+ *    @brief  Completes an ambient and white light measurement, raising
+ *            high and low interrupts once enough readings in a row cross a
+ *            threshold
+ */
+void SimVCNL4040::_measureAmbient(void) {
+  uint32_t ambient = _scene_ambient << _als_it;
+  uint32_t white = _scene_white << _als_it;
+
+  _registers[ALS_DATA] = ambient > 0xFFFF ? 0xFFFF : ambient;
+  if (!(_registers[PS_CONF3_MS] & (1 << 15))) {
+    _registers[WHITE_DATA] = white > 0xFFFF ? 0xFFFF : white;
+  }
+  _als_measured++;
+
+  uint16_t config = _registers[ALS_CONF];
+  uint8_t persistence = 1 << ((config >> 2) & 0x3);
+  uint16_t reading = _registers[ALS_DATA];
+
+  _als_high_count = persist(_als_high_count, reading > _registers[ALS_THDH]);
+  _als_low_count = persist(_als_low_count, reading < _registers[ALS_THDL]);
+  if (!(config & (1 << 1))) {
+    return;
+  }
+  if (_als_high_count >= persistence) {
+    _registers[INT_FLAG] |= ALS_IF_H;
+  }
+  if (_als_low_count >= persistence) {
+    _registers[INT_FLAG] |= ALS_IF_L;
+  }
+}
+
+/*!
+ *    @brief  Gets the time one proximity measurement integrates for
+ *    @return The time in microseconds
+ */
+uint64_t SimVCNL4040::_proximityIntegration(void) {
+  return (uint64_t)ps_half_t[(_registers[PS_CONF12] >> 1) & 0x7] * 2500;
+}
+
+/*!
+ *    @brief  Gets the time between continuous proximity measurements: the
+ *            integration time over the LED duty cycle of 1/40 to 1/320
+ *    @return The time in microseconds
+ */
+uint64_t SimVCNL4040::_proximityPeriod(void) {
+  return _proximityIntegration() << ((_registers[PS_CONF12] >> 6) & 0x3);
+}
+
+/*!
+ *    @brief  Gets the time the current ambient measurement integrates for
+ *    @return The time in microseconds
+ */
+uint64_t SimVCNL4040::_ambientPeriod(void) {
+  return (uint64_t)80000 << _als_it;
+}
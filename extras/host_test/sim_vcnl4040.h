@@ -0,0 +1,141 @@
+/*!
+ *  @file sim_vcnl4040.h
+ *
+ * 	Register-level model of the VCNL4040 for the host test harness
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#ifndef _SIM_VCNL4040_H
+#define _SIM_VCNL4040_H
+
+#include <string.h>
+
+#include "sim_clock.h"
+#include "sim_i2c_target.h"
+
+#define SIM_VCNL4040_REGISTERS 13 ///< Command codes 0x00-0x0C
+
+/*!
+ *    @brief  A VCNL4040 on a simulated `TwoWire` bus. It models the 16-bit
+ *            registers behind command codes 0x00-0x0C: configuration,
+ *            thresholds, cancellation, the data registers, the interrupt
+ *            flags that clear when read and the read-only device ID.
+ *
+ *            Measurements complete on the virtual clock. Proximity repeats
+ *            every integration time times the LED duty cycle, or runs once
+ *            per PS_TRIG in active force mode; ambient and white light
+ *            repeat every ALS integration time, 80-640 ms. A configuration
+ *            change takes effect from the next measurement, so the one in
+ *            progress completes with the old settings. Close, away, high
+ *            and low threshold interrupts are raised with their
+ *            persistence. Smart persistence and sunlight protection are not
+ *            modelled.
+ *
+ *            The scene is set in raw counts: the proximity reading before
+ *            cancellation, and the ambient and white readings at 80 ms,
+ *            which scale with a longer integration time up to 65535.
+ */
+class SimVCNL4040 : public SimI2CTarget {
+public:
+  SimVCNL4040(void);
+
+  void reset(void);
+  void setProximity(uint16_t counts);
+  void setAmbient(uint32_t counts);
+  void setWhite(uint32_t counts);
+  void setDeviceID(uint16_t id);
+
+  uint16_t peek(uint8_t command);
+  void poke(uint8_t command, uint16_t value);
+  bool interruptAsserted(void);
+  uint32_t proximityMeasurements(void);
+  uint32_t ambientMeasurements(void);
+
+  bool i2cWrite(const uint8_t *data, size_t len);
+  bool i2cRead(uint8_t *data, size_t len);
+
+private:
+  void _update(void);
+  void _write(uint8_t command, uint16_t value);
+  void _measureProximity(void);
+  void _measureAmbient(void);
+  uint64_t _proximityPeriod(void);
+  uint64_t _proximityIntegration(void);
+  uint64_t _ambientPeriod(void);
+
+  uint16_t _registers[SIM_VCNL4040_REGISTERS]; ///< The register file
+  uint8_t _command;                            ///< Command code to read
+
+  uint16_t _scene_proximity; ///< Proximity counts before cancellation
+  uint32_t _scene_ambient;   ///< Ambient counts at 80 ms
+  uint32_t _scene_white;     ///< White counts at 80 ms
+
+  bool _ps_running;        ///< A proximity measurement is in progress
+  uint64_t _ps_next_us;    ///< When it completes
+  bool _ps_one_shot;       ///< It was started by PS_TRIG
+  bool _als_running;       ///< An ambient measurement is in progress
+  uint64_t _als_next_us;   ///< When it completes
+  uint8_t _als_it;         ///< The ALS_IT it is integrating with
+  bool _ps_close;          ///< Last proximity event was close
+  uint8_t _ps_close_count; ///< Consecutive readings above PS_THDH
+  uint8_t _ps_away_count;  ///< Consecutive readings below PS_THDL
+  uint8_t _als_high_count; ///< Consecutive readings above ALS_THDH
+  uint8_t _als_low_count;  ///< Consecutive readings below ALS_THDL
+  uint32_t _ps_measured;   ///< Proximity measurements completed
+  uint32_t _als_measured;  ///< Ambient measurements completed
+};
+
+/*!
+ *    @brief  A TCA9548A-style I2C mux: one register byte whose bits connect
+ *            channels 0-7 to the bus. Attach devices behind it by passing it
+ *            as the mux to `TwoWire::attach`.
+ */
+class SimTCA9548A : public SimI2CTarget {
+public:
+  /*!
+   *    @brief  Creates a mux with every channel disconnected
+   */
+  SimTCA9548A(void) : _channels(0), _switches(0) {}
+
+  /*!
+   *    @brief  Takes the channel mask written to the mux
+   *    @param  data The bytes written; the last one is kept
+   *    @param  len The number of bytes written
+   *    @return True
+   */
+  bool i2cWrite(const uint8_t *data, size_t len) {
+    if (len) {
+      _channels = data[len - 1];
+      _switches++;
+    }
+    return true;
+  }
+  /*!
+   *    @brief  Reads back the channel mask
+   *    @param  data Where to put the mask
+   *    @param  len The number of bytes read
+   *    @return True
+   */
+  bool i2cRead(uint8_t *data, size_t len) {
+    memset(data, _channels, len);
+    return true;
+  }
+  /*!
+   *    @brief  Checks whether a channel is connected to the bus
+   *    @param  channel The channel, 0-7
+   *    @return True if it is selected
+   */
+  bool channelSelected(uint8_t channel) { return (_channels >> channel) & 1; }
+  /*!
+   *    @brief  Gets how many times the channel mask has been written
+   *    @return The number of writes
+   */
+  uint32_t switches(void) { return _switches; }
+
+private:
+  uint8_t _channels;  ///< Selected channels, bit n for channel n
+  uint32_t _switches; ///< Channel mask writes
+};
+
+#endif
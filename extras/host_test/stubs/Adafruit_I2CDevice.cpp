@@ -0,0 +1,132 @@
+/*!
+ *  @file Adafruit_I2CDevice.cpp
+ *
+ * 	Host stand-in for Adafruit BusIO's I2C device, with the same interface
+ * 	and the same transfers on the simulated TwoWire bus
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#include "Adafruit_I2CDevice.h"
+
+/*!
+ *    @brief  Creates a device on a bus, not yet begun
+ *    @param  addr The device's 7-bit I2C address
+ *    @param  theWire The bus the device is on
+ */
+Adafruit_I2CDevice::Adafruit_I2CDevice(uint8_t addr, TwoWire *theWire)
+    : _addr(addr), _wire(theWire), _begun(false),
+      _maxBufferSize(SIM_WIRE_BUFFER) {}
+
+/*!
+ *    @brief  Starts the bus and, like BusIO, checks that the device ACKs
+ *    @param  addr_detect Whether to check for the device
+ *    @return True if the device was found or not looked for
+ */
+bool Adafruit_I2CDevice::begin(bool addr_detect) {
+  _wire->begin();
+  _begun = true;
+  if (addr_detect) {
+    return detected();
+  }
+  return true;
+}
+
+/*!
+ *    @brief  Releases the bus
+ */
+void Adafruit_I2CDevice::end(void) {
+  _wire->end();
+  _begun = false;
+}
+
+/*!
+ *    @brief  Checks that the device ACKs its address with an empty write
+ *    @return True if the device was found
+ */
+bool Adafruit_I2CDevice::detected(void) {
+  if (!_begun && !begin()) {
+    return false;
+  }
+  _wire->beginTransmission(_addr);
+  return _wire->endTransmission() == 0;
+}
+
+/*!
+ *    @brief  Writes bytes to the device, after an optional prefix
+ *    @param  buffer The bytes to write
+ *    @param  len The number of bytes to write
+ *    @param  stop Whether to send a STOP afterwards
+ *    @param  prefix_buffer Bytes to write first, or NULL
+ *    @param  prefix_len The number of prefix bytes
+ *    @return True if the write was ACKed
+ */
+bool Adafruit_I2CDevice::write(const uint8_t *buffer, size_t len, bool stop,
+                               const uint8_t *prefix_buffer,
+                               size_t prefix_len) {
+  if (len + prefix_len > maxBufferSize()) {
+    return false;
+  }
+  _wire->beginTransmission(_addr);
+  if (prefix_len && _wire->write(prefix_buffer, prefix_len) != prefix_len) {
+    return false;
+  }
+  if (_wire->write(buffer, len) != len) {
+    return false;
+  }
+  return _wire->endTransmission(stop) == 0;
+}
+
+/*!
+ *    @brief  Reads bytes from the device
+ *    @param  buffer Where to put the bytes
+ *    @param  len The number of bytes to read
+ *    @param  stop Whether to send a STOP afterwards
+ *    @return True if every byte was read
+ */
+bool Adafruit_I2CDevice::read(uint8_t *buffer, size_t len, bool stop) {
+  if (len > maxBufferSize()) {
+    return false;
+  }
+  if (_wire->requestFrom(_addr, len, stop) != len) {
+    return false;
+  }
+  for (size_t i = 0; i < len; i++) {
+    buffer[i] = _wire->read();
+  }
+  return true;
+}
+
+/*!
+ *    @brief  Writes bytes then reads bytes, joined by a repeated START
+ *    @param  write_buffer The bytes to write
+ *    @param  write_len The number of bytes to write
+ *    @param  read_buffer Where to put the bytes read
+ *    @param  read_len The number of bytes to read
+ *    @param  stop Whether to send a STOP between the write and the read
+ *    @return True if both halves succeeded
+ */
+bool Adafruit_I2CDevice::write_then_read(const uint8_t *write_buffer,
+                                         size_t write_len, uint8_t *read_buffer,
+                                         size_t read_len, bool stop) {
+  if (!write(write_buffer, write_len, stop)) {
+    return false;
+  }
+  return read(read_buffer, read_len);
+}
+
+/*!
+ *    @brief  Gets the device's address
+ *    @return The 7-bit I2C address
+ */
+uint8_t Adafruit_I2CDevice::address(void) { return _addr; }
+
+/*!
+ *    @brief  Sets the bus's SCL frequency
+ *    @param  desiredclk The frequency in Hz
+ *    @return True; every frequency is supported
+ */
+bool Adafruit_I2CDevice::setSpeed(uint32_t desiredclk) {
+  _wire->setClock(desiredclk);
+  return true;
+}
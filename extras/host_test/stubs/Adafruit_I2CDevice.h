@@ -0,0 +1,47 @@
+/*!
+ *  @file Adafruit_I2CDevice.h
+ *
+ * 	Host stand-in for Adafruit BusIO's I2C device, with the same interface
+ * 	and the same transfers on the simulated TwoWire bus
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#ifndef _HOST_TEST_ADAFRUIT_I2CDEVICE_H
+#define _HOST_TEST_ADAFRUIT_I2CDEVICE_H
+
+#include <Wire.h>
+
+/*!
+ *    @brief  An I2C device on a `TwoWire` bus, as in Adafruit BusIO
+ */
+class Adafruit_I2CDevice {
+public:
+  Adafruit_I2CDevice(uint8_t addr, TwoWire *theWire = &Wire);
+  uint8_t address(void);
+  bool begin(bool addr_detect = true);
+  void end(void);
+  bool detected(void);
+
+  bool read(uint8_t *buffer, size_t len, bool stop = true);
+  bool write(const uint8_t *buffer, size_t len, bool stop = true,
+             const uint8_t *prefix_buffer = NULL, size_t prefix_len = 0);
+  bool write_then_read(const uint8_t *write_buffer, size_t write_len,
+                       uint8_t *read_buffer, size_t read_len,
+                       bool stop = false);
+  bool setSpeed(uint32_t desiredclk);
+
+  /*!
+   *    @brief  How many bytes we can read in a transaction
+   *    @return The size of the Wire receive/transmit buffer
+   */
+  size_t maxBufferSize() { return _maxBufferSize; }
+
+private:
+  uint8_t _addr;         ///< The device's I2C address
+  TwoWire *_wire;        ///< The bus the device is on
+  bool _begun;           ///< begin() has been called
+  size_t _maxBufferSize; ///< Bytes per transfer
+};
+
+#endif
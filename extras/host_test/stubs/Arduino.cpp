@@ -0,0 +1,73 @@
+/*!
+ *  @file Arduino.cpp
+ *
+ * 	Host stand-in for the Arduino core's interrupt functions. Tests raise
+ * 	a pin interrupt with simFireInterrupt().
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#include "Arduino.h"
+
+#define SIM_INTERRUPTS 64 ///< Number of pin interrupts modelled
+
+static void (*interrupt_handlers[SIM_INTERRUPTS])(void);
+static uint8_t interrupts_disabled = 0;
+
+/*!
+ *    @brief  Attaches a handler to a pin interrupt
+ *    @param  interrupt The interrupt, from digitalPinToInterrupt()
+ *    @param  handler The function to call when the interrupt fires
+ *    @param  mode The edge to fire on; every edge is treated alike
+ */
+void attachInterrupt(int interrupt, void (*handler)(void), int mode) {
+  (void)mode;
+  if (interrupt >= 0 && interrupt < SIM_INTERRUPTS) {
+    interrupt_handlers[interrupt] = handler;
+  }
+}
+
+/*!
+ *    @brief  Detaches the handler from a pin interrupt
+ *    @param  interrupt The interrupt, from digitalPinToInterrupt()
+ */
+void detachInterrupt(int interrupt) {
+  if (interrupt >= 0 && interrupt < SIM_INTERRUPTS) {
+    interrupt_handlers[interrupt] = NULL;
+  }
+}
+
+/*!
+ *    @brief  Masks interrupts. Calls nest, so each needs an interrupts().
+ */
+void noInterrupts(void) { interrupts_disabled++; }
+
+/*!
+ *    @brief  Unmasks interrupts masked by noInterrupts()
+ */
+void interrupts(void) {
+  if (interrupts_disabled) {
+    interrupts_disabled--;
+  }
+}
+
+/*!
+ *    @brief  Checks whether interrupts are unmasked
+ *    @return True if an interrupt handler could run now
+ */
+bool simInterruptsEnabled(void) { return !interrupts_disabled; }
+
+/*!
+ *    @brief  Runs the handler attached to a pin interrupt, as the hardware
+ *            would on the pin's edge
+ *    @param  interrupt The interrupt to fire
+ *    @return True if a handler was attached and interrupts were enabled
+ */
+bool simFireInterrupt(int interrupt) {
+  if (interrupt < 0 || interrupt >= SIM_INTERRUPTS ||
+      !interrupt_handlers[interrupt] || interrupts_disabled) {
+    return false;
+  }
+  interrupt_handlers[interrupt]();
+  return true;
+}
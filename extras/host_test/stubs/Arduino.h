@@ -0,0 +1,135 @@
+/*!
+ *  @file Arduino.h
+ *
+ * 	Host stand-in for the parts of the Arduino core used by the VCNL4040
+ * 	library. Time comes from the virtual clock in sim_clock.h, so delay()
+ * 	returns immediately and is counted instead of slept through.
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#ifndef _HOST_TEST_ARDUINO_H
+#define _HOST_TEST_ARDUINO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../sim_clock.h"
+
+typedef bool boolean; ///< Arduino's name for bool
+typedef uint8_t byte; ///< Arduino's name for uint8_t
+
+#define LSBFIRST 0          ///< Least significant byte first
+#define MSBFIRST 1          ///< Most significant byte first
+#define INPUT 0             ///< Pin mode: input
+#define OUTPUT 1            ///< Pin mode: output
+#define INPUT_PULLUP 2      ///< Pin mode: input with pullup
+#define CHANGE 1            ///< Interrupt on any edge
+#define FALLING 2           ///< Interrupt on a falling edge
+#define RISING 3            ///< Interrupt on a rising edge
+#define NOT_AN_INTERRUPT -1 ///< Returned for pins without an interrupt
+#define PROGMEM             ///< Flash storage, plain memory on the host
+
+#define pgm_read_byte(p) (*(const uint8_t *)(p))  ///< Reads a PROGMEM byte
+#define pgm_read_word(p) (*(const uint16_t *)(p)) ///< Reads a PROGMEM word
+
+/*!
+ *    @brief  Gets the virtual time in milliseconds
+ *    @return The time since the clock started, wrapping like the real one
+ */
+inline uint32_t millis(void) { return (uint32_t)(SimClock::micros() / 1000); }
+
+/*!
+ *    @brief  Gets the virtual time in microseconds
+ *    @return The time since the clock started, wrapping like the real one
+ */
+inline uint32_t micros(void) { return (uint32_t)SimClock::micros(); }
+
+/*!
+ *    @brief  Blocks for a while by advancing the virtual clock
+ *    @param  ms The time to block for, in milliseconds
+ */
+inline void delay(uint32_t ms) { SimClock::block((uint64_t)ms * 1000); }
+
+/*!
+ *    @brief  Blocks for a while by advancing the virtual clock
+ *    @param  us The time to block for, in microseconds
+ */
+inline void delayMicroseconds(uint32_t us) { SimClock::block(us); }
+
+/*!
+ *    @brief  Does nothing; there is no scheduler to yield to
+ */
+inline void yield(void) {}
+
+/*!
+ *    @brief  Does nothing; pins are not modelled
+ */
+inline void pinMode(uint8_t, uint8_t) {}
+
+/*!
+ *    @brief  Maps a pin to its interrupt. Every pin has one, numbered alike.
+ *    @param  pin The pin
+ *    @return The interrupt number
+ */
+inline int digitalPinToInterrupt(int pin) { return pin; }
+
+void attachInterrupt(int interrupt, void (*handler)(void), int mode);
+void detachInterrupt(int interrupt);
+void noInterrupts(void);
+void interrupts(void);
+
+bool simFireInterrupt(int interrupt);
+bool simInterruptsEnabled(void);
+
+/*!
+ *    @brief  The byte output interface of the Arduino core
+ */
+class Print {
+public:
+  virtual ~Print() {}
+  /*!
+   *    @brief  Writes one byte
+   *    @param  value The byte to write
+   *    @return The number of bytes written
+   */
+  virtual size_t write(uint8_t value) = 0;
+  /*!
+   *    @brief  Writes a buffer, one byte at a time
+   *    @param  buffer The bytes to write
+   *    @param  size The number of bytes to write
+   *    @return The number of bytes written
+   */
+  virtual size_t write(const uint8_t *buffer, size_t size) {
+    size_t written = 0;
+    while (written < size && write(buffer[written])) {
+      written++;
+    }
+    return written;
+  }
+};
+
+/*!
+ *    @brief  The byte input interface of the Arduino core
+ */
+class Stream : public Print {
+public:
+  /*!
+   *    @brief  Gets the number of bytes that can be read
+   *    @return The number of bytes available
+   */
+  virtual int available(void) = 0;
+  /*!
+   *    @brief  Reads one byte
+   *    @return The byte, or -1 if none is available
+   */
+  virtual int read(void) = 0;
+  /*!
+   *    @brief  Gets the next byte without reading it
+   *    @return The byte, or -1 if none is available
+   */
+  virtual int peek(void) = 0;
+};
+
+#endif
@@ -0,0 +1,233 @@
+/*!
+ *  @file Wire.cpp
+ *
+ * 	Host stand-in for the Arduino TwoWire I2C bus, routing transfers to
+ * 	simulated devices and counting what goes over the wire
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#include "Wire.h"
+
+TwoWire Wire;
+
+/*!
+ *    @brief  Instantiates a bus with nothing attached, at 100 kHz
+ */
+TwoWire::TwoWire(void)
+    : _targets(), _target_count(0), _frequency(100000), _address(0),
+      _tx_buffer(), _tx_length(0), _rx_buffer(), _rx_length(0), _rx_index(0),
+      _fail_next(0), _stats() {}
+
+/*!
+ *    @brief  Does nothing; the bus is always ready
+ */
+void TwoWire::begin(void) {}
+
+/*!
+ *    @brief  Does nothing; the bus is always ready
+ */
+void TwoWire::end(void) {}
+
+/*!
+ *    @brief  Sets the SCL frequency, which sets how long transfers take
+ *    @param  frequency The frequency in Hz
+ */
+void TwoWire::setClock(uint32_t frequency) {
+  if (frequency) {
+    _frequency = frequency;
+  }
+}
+
+/*!
+ *    @brief  Starts buffering a write to a device
+ *    @param  address The device's I2C address
+ */
+void TwoWire::beginTransmission(uint8_t address) {
+  _address = address;
+  _tx_length = 0;
+}
+
+/*!
+ *    @brief  Buffers a byte to write
+ *    @param  value The byte
+ *    @return 1, or 0 if the buffer is full
+ */
+size_t TwoWire::write(uint8_t value) {
+  if (_tx_length >= SIM_WIRE_BUFFER) {
+    return 0;
+  }
+  _tx_buffer[_tx_length++] = value;
+  return 1;
+}
+
+/*!
+ *    @brief  Buffers bytes to write
+ *    @param  buffer The bytes
+ *    @param  size The number of bytes
+ *    @return The number of bytes that fit in the buffer
+ */
+size_t TwoWire::write(const uint8_t *buffer, size_t size) {
+  size_t written = 0;
+  while (written < size && write(buffer[written])) {
+    written++;
+  }
+  return written;
+}
+
+/*!
+ *    @brief  Writes the buffered bytes to the device
+ *    @param  stop False to hold the bus for a repeated START
+ *    @return 0 on success, 2 if the address was NACKed
+ */
+uint8_t TwoWire::endTransmission(bool stop) {
+  SimI2CTarget *target = _route(_address);
+  bool ok = target && target->i2cWrite(_tx_buffer, _tx_length);
+
+  // a NACKed address ends the transfer after the address byte
+  _wire(ok ? 1 + _tx_length : 1, stop || !ok);
+  if (!ok) {
+    _stats.nacks++;
+    return 2;
+  }
+  return 0;
+}
+
+/*!
+ *    @brief  Reads bytes from a device into the receive buffer
+ *    @param  address The device's I2C address
+ *    @param  quantity The number of bytes to read
+ *    @param  stop False to hold the bus for a repeated START
+ *    @return The number of bytes read, 0 if the address was NACKed
+ */
+size_t TwoWire::requestFrom(uint8_t address, size_t quantity, bool stop) {
+  if (quantity > SIM_WIRE_BUFFER) {
+    quantity = SIM_WIRE_BUFFER;
+  }
+  SimI2CTarget *target = _route(address);
+  bool ok = target && target->i2cRead(_rx_buffer, quantity);
+
+  _rx_index = 0;
+  _rx_length = ok ? quantity : 0;
+  _wire(1 + _rx_length, stop || !ok);
+  if (!ok) {
+    _stats.nacks++;
+  }
+  return _rx_length;
+}
+
+/*!
+ *    @brief  Gets the number of received bytes not yet taken
+ *    @return The number of bytes available
+ */
+int TwoWire::available(void) { return _rx_length - _rx_index; }
+
+/*!
+ *    @brief  Takes a received byte
+ *    @return The byte, or -1 if there are none left
+ */
+int TwoWire::read(void) {
+  return _rx_index < _rx_length ? _rx_buffer[_rx_index++] : -1;
+}
+
+/*!
+ *    @brief  Gets the next received byte without taking it
+ *    @return The byte, or -1 if there are none left
+ */
+int TwoWire::peek(void) {
+  return _rx_index < _rx_length ? _rx_buffer[_rx_index] : -1;
+}
+
+/*!
+ *    @brief  Connects a simulated device to the bus
+ *    @param  target The device
+ *    @param  address Its I2C address
+ *    @param  mux The mux it is behind, or NULL if it is on the bus itself
+ *    @param  channel The mux channel it is on
+ *    @return False if the bus has no room for another device
+ */
+bool TwoWire::attach(SimI2CTarget *target, uint8_t address, SimI2CTarget *mux,
+                     uint8_t channel) {
+  if (_target_count >= SIM_WIRE_TARGETS) {
+    return false;
+  }
+  Attachment *attachment = &_targets[_target_count++];
+  attachment->target = target;
+  attachment->mux = mux;
+  attachment->address = address;
+  attachment->channel = channel;
+  return true;
+}
+
+/*!
+ *    @brief  Disconnects a simulated device, so its address is NACKed
+ *    @param  target The device
+ */
+void TwoWire::detach(SimI2CTarget *target) {
+  uint8_t kept = 0;
+  for (uint8_t i = 0; i < _target_count; i++) {
+    if (_targets[i].target != target) {
+      _targets[kept++] = _targets[i];
+    }
+  }
+  _target_count = kept;
+}
+
+/*!
+ *    @brief  NACKs the next few transfers whatever their address, as a
+ *            glitching bus would
+ *    @param  transfers The number of transfers to fail
+ */
+void TwoWire::failNext(uint16_t transfers) { _fail_next = transfers; }
+
+/*!
+ *    @brief  Gets the traffic counted since the last reset
+ *    @param  stats Where to store the counts
+ */
+void TwoWire::getStats(SimBusStats *stats) { *stats = _stats; }
+
+/*!
+ *    @brief  Zeroes the traffic counts
+ */
+void TwoWire::resetStats(void) { memset(&_stats, 0, sizeof(_stats)); }
+
+/*!
+ *    @brief  Finds the device that answers an address. A device behind a
+ *            mux only answers while its channel is selected.
+ *    @param  address The I2C address
+ *    @return The device, or NULL if the address would be NACKed
+ */
+SimI2CTarget *TwoWire::_route(uint8_t address) {
+  if (_fail_next) {
+    _fail_next--;
+    return NULL;
+  }
+  for (uint8_t i = 0; i < _target_count; i++) {
+    Attachment *attachment = &_targets[i];
+    if (attachment->address == address &&
+        (!attachment->mux ||
+         attachment->mux->channelSelected(attachment->channel))) {
+      return attachment->target;
+    }
+  }
+  return NULL;
+}
+
+/*!
+ *    @brief  Counts a transfer and advances the clock for its time on the
+ *            wire: nine clocks a byte, plus a START and maybe a STOP
+ *    @param  bytes The address and data bytes transferred
+ *    @param  stop True if the transfer ended with a STOP
+ */
+void TwoWire::_wire(uint16_t bytes, bool stop) {
+  uint32_t clocks = 9 * bytes + 1 + (stop ? 1 : 0);
+
+  _stats.bytes += bytes;
+  if (stop) {
+    _stats.transactions++;
+  }
+
+  uint64_t us = ((uint64_t)clocks * 1000000 + _frequency - 1) / _frequency;
+  _stats.bus_us += us;
+  SimClock::busTransfer(us);
+}
@@ -0,0 +1,88 @@
+/*!
+ *  @file Wire.h
+ *
+ * 	Host stand-in for the Arduino TwoWire I2C bus, routing transfers to
+ * 	simulated devices and counting what goes over the wire
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#ifndef _HOST_TEST_WIRE_H
+#define _HOST_TEST_WIRE_H
+
+#include "../sim_i2c_target.h"
+#include "Arduino.h"
+
+#define SIM_WIRE_BUFFER 32  ///< Bytes per transfer, as on an AVR
+#define SIM_WIRE_TARGETS 16 ///< Devices that can be attached to one bus
+
+/*!
+ *    @brief  Bus traffic counted by `TwoWire`. A transaction runs from a
+ *            START to a STOP, so a write then a read joined by a repeated
+ *            START is one. Bytes include every address byte.
+ */
+typedef struct sim_bus_stats {
+  uint32_t transactions; ///< STOP-terminated transfers
+  uint32_t bytes;        ///< Address and data bytes on the wire
+  uint32_t nacks;        ///< Transfers that were NACKed
+  uint64_t bus_us;       ///< Time the bus was busy
+} SimBusStats;
+
+/*!
+ *    @brief  A simulated I2C bus. Each transfer is routed to the attached
+ *            device at its address, or NACKed if there is none, and the
+ *            virtual clock advances for the time it takes on the wire.
+ */
+class TwoWire : public Stream {
+public:
+  TwoWire(void);
+
+  void begin(void);
+  void end(void);
+  void setClock(uint32_t frequency);
+  void beginTransmission(uint8_t address);
+  uint8_t endTransmission(bool stop = true);
+  size_t requestFrom(uint8_t address, size_t quantity, bool stop = true);
+  size_t write(uint8_t value);
+  size_t write(const uint8_t *buffer, size_t size);
+  int available(void);
+  int read(void);
+  int peek(void);
+
+  bool attach(SimI2CTarget *target, uint8_t address,
+              SimI2CTarget *mux = NULL, uint8_t channel = 0);
+  void detach(SimI2CTarget *target);
+  void failNext(uint16_t transfers);
+  void getStats(SimBusStats *stats);
+  void resetStats(void);
+
+private:
+  SimI2CTarget *_route(uint8_t address);
+  void _wire(uint16_t bytes, bool stop);
+
+  /*!
+   *    @brief  Where an attached device is on the bus
+   */
+  struct Attachment {
+    SimI2CTarget *target; ///< The device
+    SimI2CTarget *mux;    ///< The mux it is behind, or NULL
+    uint8_t address;      ///< Its I2C address
+    uint8_t channel;      ///< The mux channel it is on
+  };
+
+  Attachment _targets[SIM_WIRE_TARGETS]; ///< The attached devices
+  uint8_t _target_count;                 ///< Number of attached devices
+  uint32_t _frequency;                   ///< SCL frequency in Hz
+  uint8_t _address;                      ///< Address being written to
+  uint8_t _tx_buffer[SIM_WIRE_BUFFER];   ///< Bytes waiting to be written
+  uint8_t _tx_length;                    ///< Number of bytes waiting
+  uint8_t _rx_buffer[SIM_WIRE_BUFFER];   ///< Bytes read, not yet taken
+  uint8_t _rx_length;                    ///< Number of bytes read
+  uint8_t _rx_index;                     ///< Next byte to take
+  uint16_t _fail_next;                   ///< Transfers left to NACK
+  SimBusStats _stats;                    ///< Traffic so far
+};
+
+extern TwoWire Wire; ///< The default bus
+
+#endif
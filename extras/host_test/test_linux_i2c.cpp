@@ -0,0 +1,139 @@
+/*!
+ *  @file test_linux_i2c.cpp
+ *
+ * 	Tests of the VCNL4040 driver on the Linux i2c-dev port in extras/linux,
+ * 	against the simulated sensor on a simulated i2c-dev bus. The driver's
+ * 	clock is the real one here, so only the sensor model's clock is moved.
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#include "Adafruit_VCNL4040.h"
+#include "sim_i2c_dev.h"
+#include "sim_vcnl4040.h"
+#include "test_runner.h"
+
+/*!
+ *    @brief  A simulated sensor on a simulated /dev/i2c-1, the bus of `Wire`
+ */
+class SimI2CDevRig {
+public:
+  /*!
+   *    @brief  Resets the model's clock and attaches the sensor at 0x60
+   */
+  SimI2CDevRig(void) {
+    SimClock::reset();
+    simI2CDevReset();
+    simI2CDevAttach("/dev/i2c-1", &chip, VCNL4040_I2CADDR_DEFAULT);
+  }
+  /*!
+   *    @brief  Closes the bus and removes the simulated devices
+   */
+  ~SimI2CDevRig(void) {
+    Wire.end();
+    simI2CDevReset();
+  }
+
+  SimVCNL4040 chip; ///< The simulated sensor
+};
+
+TEST(linux_begin_finds_sensor) {
+  SimI2CDevRig rig;
+  Adafruit_VCNL4040 sensor;
+
+  CHECK(sensor.begin());
+  CHECK(simI2CDevOpen("/dev/i2c-1"));
+  CHECK_EQUAL(0x0000, rig.chip.peek(VCNL4040_ALS_CONFIG) & 0x1);
+}
+
+TEST(linux_begin_fails_without_sensor) {
+  SimI2CDevRig rig;
+  Adafruit_VCNL4040 sensor;
+
+  CHECK(!sensor.begin(0x61));
+}
+
+TEST(linux_begin_fails_without_bus) {
+  SimI2CDevRig rig;
+  Adafruit_VCNL4040 sensor;
+  TwoWire missing("/dev/i2c-sim-missing");
+
+  CHECK(!sensor.begin(VCNL4040_I2CADDR_DEFAULT, &missing));
+}
+
+TEST(linux_register_read_is_one_ioctl) {
+  SimI2CDevRig rig;
+  Adafruit_VCNL4040 sensor;
+
+  CHECK(sensor.begin());
+  rig.chip.setProximity(1234);
+  SimClock::advanceMillis(100);
+  uint32_t ioctls = simI2CDevIoctls();
+  uint32_t messages = simI2CDevMessages();
+  CHECK_EQUAL(1234, sensor.getProximity());
+  CHECK_EQUAL(ioctls + 1, simI2CDevIoctls());
+  // the command code write, then the read after a repeated START
+  CHECK_EQUAL(messages + 2, simI2CDevMessages());
+}
+
+TEST(linux_read_all_is_one_ioctl) {
+  SimI2CDevRig rig;
+  Adafruit_VCNL4040 sensor;
+  VCNL4040_Sample sample;
+  VCNL4040_BusStats stats;
+
+  CHECK(sensor.begin());
+  rig.chip.setProximity(300);
+  rig.chip.setAmbient(1000);
+  rig.chip.setWhite(2000);
+  SimClock::advanceMillis(200);
+  sensor.resetBusStats();
+  uint32_t ioctls = simI2CDevIoctls();
+  uint32_t messages = simI2CDevMessages();
+  CHECK(sensor.readAll(&sample, true));
+  CHECK_EQUAL(ioctls + 1, simI2CDevIoctls());
+  CHECK_EQUAL(messages + 8, simI2CDevMessages());
+  CHECK_EQUAL(300, sample.proximity);
+  CHECK_EQUAL(1000, sample.ambient);
+  CHECK_EQUAL(2000, sample.white);
+  sensor.getBusStats(&stats);
+  CHECK_EQUAL(1, stats.transactions);
+}
+
+TEST(linux_failed_batch_is_retried) {
+  SimI2CDevRig rig;
+  Adafruit_VCNL4040 sensor;
+  VCNL4040_Sample sample;
+  VCNL4040_BusStats stats;
+
+  CHECK(sensor.begin());
+  sensor.setRetryLimit(1);
+  sensor.resetBusStats();
+  simI2CDevFailNext(2);
+  CHECK(!sensor.readAll(&sample));
+  sensor.getBusStats(&stats);
+  CHECK_EQUAL(2, stats.transactions);
+  CHECK_EQUAL(1, stats.failures);
+  CHECK(!sensor.lastTransactionOk());
+
+  simI2CDevFailNext(1);
+  CHECK(sensor.readAll(&sample));
+  sensor.getBusStats(&stats);
+  CHECK_EQUAL(2, stats.retries);
+}
+
+TEST(linux_wire_writes_one_message) {
+  SimI2CDevRig rig;
+
+  Wire.beginTransmission(VCNL4040_I2CADDR_DEFAULT);
+  Wire.write(VCNL4040_PS_CANC);
+  Wire.write(0x34);
+  Wire.write(0x12);
+  CHECK_EQUAL(0, Wire.endTransmission());
+  CHECK_EQUAL(1, simI2CDevIoctls());
+  CHECK_EQUAL(0x1234, rig.chip.peek(VCNL4040_PS_CANC));
+
+  Wire.beginTransmission(0x61);
+  Wire.write(0);
+  CHECK_EQUAL(4, Wire.endTransmission());
+}
@@ -0,0 +1,70 @@
+/*!
+ *  @file test_runner.cpp
+ *
+ * 	Minimal test runner for the host test harness
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#include "test_runner.h"
+
+#include <stdio.h>
+
+TestCase *TestCase::_first = 0;
+TestCase *TestCase::_last = 0;
+bool TestCase::_failed = false;
+
+/*!
+ *    @brief  Registers a test, to run in the order registered
+ *    @param  name The test's name
+ *    @param  function The test body
+ */
+TestCase::TestCase(const char *name, void (*function)(void))
+    : _name(name), _function(function), _next(0) {
+  if (_last) {
+    _last->_next = this;
+  } else {
+    _first = this;
+  }
+  _last = this;
+}
+
+/*!
+ *    @brief  Reports a failed check in the running test
+ *    @param  file The source file of the check
+ *    @param  line The line of the check
+ *    @param  expression The expression checked
+ *    @param  expected The value expected
+ *    @param  actual The value found
+ */
+void TestCase::fail(const char *file, int line, const char *expression,
+                    long expected, long actual) {
+  printf("  %s:%d: %s: expected %ld, got %ld\n", file, line, expression,
+         expected, actual);
+  _failed = true;
+}
+
+/*!
+ *    @brief  Runs every registered test
+ *    @return The number of tests that failed
+ */
+int TestCase::runAll(void) {
+  int failures = 0;
+  int count = 0;
+
+  for (TestCase *test = _first; test; test = test->_next) {
+    _failed = false;
+    test->_function();
+    printf("%s %s\n", _failed ? "FAIL" : "ok  ", test->_name);
+    failures += _failed;
+    count++;
+  }
+  printf("%d of %d tests passed\n", count - failures, count);
+  return failures;
+}
+
+/*!
+ *    @brief  Runs the tests
+ *    @return 0 if they all passed, 1 otherwise
+ */
+int main(void) { return TestCase::runAll() ? 1 : 0; }
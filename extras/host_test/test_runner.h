@@ -0,0 +1,67 @@
+/*!
+ *  @file test_runner.h
+ *
+ * 	Minimal test runner for the host test harness
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#ifndef _HOST_TEST_RUNNER_H
+#define _HOST_TEST_RUNNER_H
+
+#include <stdint.h>
+
+/*!
+ *    @brief  A test, registered by `TEST` before main() runs
+ */
+class TestCase {
+public:
+  TestCase(const char *name, void (*function)(void));
+
+  static int runAll(void);
+  static void fail(const char *file, int line, const char *expression,
+                   long expected, long actual);
+
+private:
+  const char *_name;       ///< The test's name
+  void (*_function)(void); ///< The test body
+  TestCase *_next;         ///< The next test registered
+  static TestCase *_first; ///< The first test registered
+  static TestCase *_last;  ///< The last test registered
+  static bool _failed;     ///< The running test has failed
+};
+
+/*!
+ *    @brief  Defines and registers a test
+ */
+#define TEST(name)                                                             \
+  static void name(void);                                                      \
+  static TestCase name##_case(#name, name);                                    \
+  static void name(void)
+
+/*!
+ *    @brief  Fails the test, and returns from it, unless a condition holds
+ */
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      TestCase::fail(__FILE__, __LINE__, #condition, 1, 0);                    \
+      return;                                                                  \
+    }                                                                          \
+  } while (0)
+
+/*!
+ *    @brief  Fails the test, and returns from it, unless two integers are
+ *            equal
+ */
+#define CHECK_EQUAL(expected, actual)                                          \
+  do {                                                                         \
+    long _expected = (long)(expected);                                         \
+    long _actual = (long)(actual);                                             \
+    if (_expected != _actual) {                                                \
+      TestCase::fail(__FILE__, __LINE__, #actual, _expected, _actual);         \
+      return;                                                                  \
+    }                                                                          \
+  } while (0)
+
+#endif
@@ -0,0 +1,442 @@
+/*!
+ *  @file test_vcnl4040.cpp
+ *
+ * 	Tests of the VCNL4040 driver against the simulated sensor
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#include "Adafruit_VCNL4040.h"
+#include "Adafruit_VCNL4040_Governor.h"
+#include "Adafruit_VCNL4040_Group.h"
+#include "Adafruit_VCNL4040_Recorder.h"
+#include "Adafruit_VCNL4040_SampleRing.h"
+#include "harness.h"
+#include "test_runner.h"
+
+TEST(begin_checks_device_id) {
+  SimSensorRig rig;
+  Adafruit_VCNL4040 sensor;
+
+  CHECK(sensor.begin());
+  rig.chip.setDeviceID(0x0187);
+  CHECK(!sensor.begin());
+}
+
+TEST(begin_fails_without_sensor) {
+  Adafruit_VCNL4040 sensor;
+
+  SimClock::reset();
+  CHECK(!sensor.begin());
+}
+
+TEST(begin_enables_measurements) {
+  SimSensorRig rig;
+  Adafruit_VCNL4040 sensor;
+
+  CHECK(sensor.begin());
+  CHECK_EQUAL(0x0000, rig.chip.peek(VCNL4040_ALS_CONFIG) & 0x1);
+  CHECK_EQUAL(0x0000, rig.chip.peek(VCNL4040_PS_CONF1_L) & 0x1);
+  CHECK_EQUAL(0x0000, rig.chip.peek(VCNL4040_PS_MS_H) & (1 << 15));
+}
+
+TEST(proximity_follows_scene_less_cancellation) {
+  SimSensorRig rig;
+  Adafruit_VCNL4040 sensor;
+
+  CHECK(sensor.begin());
+  rig.chip.setProximity(1234);
+  SimClock::advanceMillis(sensor.getProximityMeasurementPeriod());
+  CHECK_EQUAL(1234, sensor.getProximity());
+
+  sensor.setProximityCancellation(200);
+  SimClock::advanceMillis(sensor.getProximityMeasurementPeriod());
+  CHECK_EQUAL(1034, sensor.getProximity());
+}
+
+TEST(proximity_ready_when_model_has_measured) {
+  SimSensorRig rig;
+  Adafruit_VCNL4040 sensor;
+
+  CHECK(sensor.begin());
+  sensor.getProximity();
+  uint32_t measured = rig.chip.proximityMeasurements();
+  CHECK(!sensor.proximityDataReady());
+  while (!sensor.proximityDataReady()) {
+    SimClock::advance(100);
+  }
+  CHECK(rig.chip.proximityMeasurements() > measured);
+}
+
+TEST(ambient_counts_scale_with_integration_time) {
+  SimSensorRig rig;
+  Adafruit_VCNL4040 sensor;
+
+  CHECK(sensor.begin());
+  rig.chip.setAmbient(1000);
+  rig.chip.setWhite(1500);
+  SimClock::advanceMillis(sensor.getAmbientMeasurementPeriod());
+  CHECK_EQUAL(1000, sensor.getAmbientLight());
+  // white light is scaled like lux, 0.1 per count at 80 ms
+  CHECK_EQUAL(150, sensor.getWhiteLight());
+
+  sensor.setAmbientIntegrationTime(VCNL4040_AMBIENT_INTEGRATION_TIME_160MS);
+  while (sensor.ambientSettling()) {
+    SimClock::advance(1000);
+  }
+  CHECK_EQUAL(2000, sensor.getAmbientLight());
+}
+
+TEST(ambient_saturates) {
+  SimSensorRig rig;
+  Adafruit_VCNL4040 sensor;
+
+  CHECK(sensor.begin(VCNL4040_Config().ambientIntegrationTime(
+      VCNL4040_AMBIENT_INTEGRATION_TIME_640MS)));
+  rig.chip.setAmbient(20000);
+  SimClock::advanceMillis(sensor.getAmbientMeasurementPeriod());
+  CHECK_EQUAL(0xFFFF, sensor.getAmbientLight());
+}
+
+TEST(proximity_close_and_away_interrupts) {
+  SimSensorRig rig;
+  Adafruit_VCNL4040 sensor;
+
+  CHECK(sensor.begin(
+      VCNL4040_Config()
+          .proximityThresholds(100, 200)
+          .proximityInterrupts(VCNL4040_PROXIMITY_INT_CLOSE_AWAY)));
+  rig.chip.setProximity(500);
+  SimClock::advanceMillis(sensor.getProximityMeasurementPeriod());
+  CHECK(rig.chip.interruptAsserted());
+  CHECK_EQUAL(VCNL4040_PROXIMITY_CLOSE, sensor.getInterruptStatus());
+  CHECK(!rig.chip.interruptAsserted());
+
+  rig.chip.setProximity(50);
+  SimClock::advanceMillis(sensor.getProximityMeasurementPeriod());
+  CHECK_EQUAL(VCNL4040_PROXIMITY_AWAY, sensor.getInterruptStatus());
+}
+
+TEST(proximity_interrupt_persistence) {
+  SimSensorRig rig;
+  Adafruit_VCNL4040 sensor;
+
+  CHECK(sensor.begin(
+      VCNL4040_Config()
+          .proximityThresholds(100, 200)
+          .proximityPersistence(VCNL4040_PROXIMITY_PERSISTENCE_3)
+          .proximityInterrupts(VCNL4040_PROXIMITY_INT_CLOSE)));
+  uint16_t period_ms = sensor.getProximityMeasurementPeriod();
+
+  rig.chip.setProximity(500);
+  SimClock::advanceMillis(2 * period_ms);
+  CHECK(!rig.chip.interruptAsserted());
+  SimClock::advanceMillis(period_ms);
+  CHECK(rig.chip.interruptAsserted());
+}
+
+TEST(ambient_threshold_interrupts) {
+  SimSensorRig rig;
+  Adafruit_VCNL4040 sensor;
+
+  CHECK(sensor.begin(VCNL4040_Config()
+                         .ambientLightThresholds(100, 1000)
+                         .ambientLightInterrupts(true)));
+  rig.chip.setAmbient(2000);
+  SimClock::advanceMillis(sensor.getAmbientMeasurementPeriod());
+  CHECK_EQUAL(VCNL4040_AMBIENT_HIGH, sensor.getInterruptStatus());
+
+  rig.chip.setAmbient(10);
+  SimClock::advanceMillis(sensor.getAmbientMeasurementPeriod());
+  CHECK_EQUAL(VCNL4040_AMBIENT_LOW, sensor.getInterruptStatus());
+}
+
+TEST(interrupt_pin_is_serviced) {
+  SimSensorRig rig;
+  Adafruit_VCNL4040 sensor;
+
+  CHECK(sensor.begin(VCNL4040_Config()
+                         .proximityThresholds(100, 200)
+                         .proximityInterrupts(VCNL4040_PROXIMITY_INT_CLOSE)));
+  sensor.attachInterruptPin(2);
+  rig.chip.setProximity(500);
+  SimClock::advanceMillis(sensor.getProximityMeasurementPeriod());
+  CHECK(rig.chip.interruptAsserted());
+  CHECK(simFireInterrupt(2));
+  CHECK_EQUAL(VCNL4040_PROXIMITY_CLOSE, sensor.serviceInterrupts());
+  sensor.detachInterruptPin();
+}
+
+TEST(active_force_measures_only_when_triggered) {
+  SimSensorRig rig;
+  Adafruit_VCNL4040 sensor;
+  VCNL4040_Sample sample;
+  uint16_t proximity;
+
+  CHECK(sensor.begin());
+  sensor.enableProximityActiveForce(true);
+  uint32_t measured = rig.chip.proximityMeasurements();
+  SimClock::advanceMillis(1000);
+  CHECK_EQUAL(measured, rig.chip.proximityMeasurements());
+  CHECK(!sensor.proximityDataReady());
+  CHECK(sensor.readAll(&sample));
+  CHECK(!(sample.flags & VCNL4040_SAMPLE_PROXIMITY_FRESH));
+
+  rig.chip.setProximity(321);
+  CHECK(sensor.triggerProximity());
+  CHECK(!sensor.pollProximityResult(&proximity));
+  while (!sensor.pollProximityResult(&proximity)) {
+    SimClock::advance(500);
+  }
+  CHECK_EQUAL(321, proximity);
+  CHECK_EQUAL(measured + 1, rig.chip.proximityMeasurements());
+  CHECK(!sensor.proximityDataReady());
+}
+
+TEST(trigger_in_discarded_batch_leaves_config) {
+  SimSensorRig rig;
+  Adafruit_VCNL4040 sensor;
+
+  CHECK(sensor.begin());
+  sensor.beginConfigBatch();
+  sensor.setProximityLEDCurrent(VCNL4040_LED_CURRENT_200MA);
+  CHECK(sensor.triggerProximity());
+  sensor.discardConfigBatch();
+  CHECK(sensor.verifyConfig());
+  CHECK_EQUAL(VCNL4040_LED_CURRENT_50MA,
+              (rig.chip.peek(VCNL4040_PS_MS_H) >> 8) & 0x7);
+}
+
+TEST(settling_survives_millis_wrap) {
+  SimSensorRig rig;
+  Adafruit_VCNL4040 sensor;
+
+  // start just short of millis() wrapping past 2^31 ms from the change
+  SimClock::reset((uint64_t)0x7FFFFF00 * 1000);
+  CHECK(sensor.begin());
+  rig.chip.setAmbient(100);
+  sensor.setAmbientIntegrationTime(VCNL4040_AMBIENT_INTEGRATION_TIME_160MS);
+  SimClock::advanceMillis(0x80000000UL + 5000);
+  CHECK(!sensor.ambientSettling());
+  CHECK_EQUAL(200, sensor.getAmbientLight());
+}
+
+TEST(retries_recover_from_nack) {
+  SimSensorRig rig;
+  Adafruit_VCNL4040 sensor;
+  VCNL4040_BusStats stats;
+
+  CHECK(sensor.begin());
+  rig.chip.setProximity(77);
+  SimClock::advanceMillis(sensor.getProximityMeasurementPeriod());
+  sensor.setRetryLimit(1);
+  sensor.resetBusStats();
+  Wire.failNext(1);
+  CHECK_EQUAL(77, sensor.getProximity());
+  CHECK(sensor.lastTransactionOk());
+  sensor.getBusStats(&stats);
+  CHECK_EQUAL(1, stats.retries);
+  CHECK_EQUAL(2, stats.transactions);
+}
+
+TEST(register_reads_cost_one_transaction) {
+  SimSensorRig rig;
+  Adafruit_VCNL4040 sensor;
+
+  CHECK(sensor.begin());
+  SimCostMeter meter;
+  sensor.getProximity();
+  SimCost cost = meter.read();
+  CHECK_EQUAL(1, cost.transactions);
+  // address + command code, repeated start address + two data bytes
+  CHECK_EQUAL(5, cost.bytes);
+  CHECK_EQUAL(0, cost.delay_ms);
+}
+
+static VCNL4040_Sample group_sample;
+
+static void keepGroupSample(uint8_t index, const VCNL4040_Sample *sample) {
+  (void)index;
+  group_sample = *sample;
+}
+
+TEST(group_poll_reads_only_due_channels) {
+  SimSensorRig rig;
+  Adafruit_VCNL4040 sensor;
+  Adafruit_VCNL4040_Group group;
+
+  rig.chip.setProximity(300);
+  rig.chip.setAmbient(1000);
+  CHECK_EQUAL(0, group.addSensor(&sensor));
+  CHECK(group.begin());
+  SimClock::advanceMillis(sensor.getAmbientMeasurementPeriod());
+  CHECK_EQUAL(1, group.poll(keepGroupSample));
+  CHECK_EQUAL(1000, group_sample.ambient);
+
+  rig.chip.setProximity(400);
+  rig.chip.setAmbient(2000);
+  SimClock::advanceMillis(sensor.getProximityMeasurementPeriod());
+  CHECK(sensor.proximityDataReady());
+  CHECK(!sensor.ambientDataReady());
+  SimCostMeter meter;
+  CHECK_EQUAL(1, group.poll(keepGroupSample));
+  CHECK_EQUAL(1, meter.read().transactions);
+  CHECK_EQUAL(VCNL4040_SAMPLE_PROXIMITY_FRESH, group_sample.flags);
+  CHECK_EQUAL(400, group_sample.proximity);
+  CHECK_EQUAL(1000, group_sample.ambient);
+}
+
+TEST(group_rejects_bad_mux_channel) {
+  Adafruit_VCNL4040 sensor;
+  Adafruit_VCNL4040_Group group;
+
+  CHECK_EQUAL(-1, group.addSensor(&sensor, &Wire, 0x70, 8));
+  CHECK_EQUAL(0, group.addSensor(&sensor, &Wire, 0x70, 7));
+}
+
+TEST(sample_ring_keeps_read_and_request_times) {
+  SimSensorRig rig;
+  Adafruit_VCNL4040 sensor;
+  Adafruit_VCNL4040_SampleRing<4> ring;
+  VCNL4040_Sample sample;
+  uint32_t requested_ms;
+
+  CHECK(sensor.begin());
+  SimClock::advanceMillis(100);
+  uint32_t request_time = millis();
+  ring.requestCapture();
+  ring.requestCapture();
+  CHECK_EQUAL(1, ring.getOverflowCount());
+  SimClock::advanceMillis(7);
+  CHECK(ring.service(&sensor));
+  CHECK(ring.pop(&sample, &requested_ms));
+  CHECK_EQUAL(request_time, requested_ms);
+  CHECK_EQUAL(request_time + 7, sample.timestamp);
+
+  ring.requestCapture();
+  Wire.failNext(16);
+  CHECK(!ring.service(&sensor));
+  CHECK_EQUAL(2, ring.getOverflowCount());
+  CHECK(!ring.service(&sensor));
+  CHECK_EQUAL(2, ring.getOverflowCount());
+}
+
+TEST(auto_ranged_lux_stores_its_reading) {
+  SimSensorRig rig;
+  Adafruit_VCNL4040 sensor;
+  VCNL4040_AmbientIntegration integration_time;
+  uint32_t millilux;
+
+  rig.chip.setAmbient(10000);
+  CHECK(sensor.begin());
+  sensor.enableAmbientAutoRange(true);
+  sensor.enableResultCache(true);
+  SimClock::advanceMillis(sensor.getAmbientMeasurementPeriod());
+  CHECK(sensor.getAutoRangedLux(&millilux, &integration_time));
+  SimCostMeter meter;
+  CHECK_EQUAL(10000, sensor.getAmbientLight());
+  CHECK_EQUAL(0, meter.read().transactions);
+}
+
+TEST(legacy_register_writes_need_sync_config) {
+  SimSensorRig rig;
+  Adafruit_VCNL4040 sensor;
+
+  CHECK(sensor.begin());
+  CHECK(sensor.ALS_CONFIG->write(VCNL4040_AMBIENT_INTEGRATION_TIME_320MS << 6,
+                                 2));
+  CHECK_EQUAL(VCNL4040_AMBIENT_INTEGRATION_TIME_320MS << 6,
+              rig.chip.peek(VCNL4040_ALS_CONFIG));
+  CHECK_EQUAL(VCNL4040_AMBIENT_INTEGRATION_TIME_80MS,
+              sensor.getAmbientIntegrationTime());
+  CHECK(sensor.syncConfig());
+  CHECK_EQUAL(VCNL4040_AMBIENT_INTEGRATION_TIME_320MS,
+              sensor.getAmbientIntegrationTime());
+}
+
+/*!
+ *    @brief  A recording held in memory, written then read back
+ */
+class MemoryStream : public Stream {
+public:
+  /*!
+   *    @brief  Creates an empty stream
+   */
+  MemoryStream(void) : _length(0), _position(0) {}
+  /*!
+   *    @brief  Appends a byte
+   *    @param  value The byte
+   *    @return 1, or 0 if the stream is full
+   */
+  size_t write(uint8_t value) {
+    if (_length == sizeof(_data)) {
+      return 0;
+    }
+    _data[_length++] = value;
+    return 1;
+  }
+  /*!
+   *    @brief  Gets the number of bytes left to read
+   *    @return The number of bytes
+   */
+  int available(void) { return _length - _position; }
+  /*!
+   *    @brief  Reads the next byte
+   *    @return The byte, or -1 at the end
+   */
+  int read(void) { return _position < _length ? _data[_position++] : -1; }
+  /*!
+   *    @brief  Gets the next byte without reading it
+   *    @return The byte, or -1 at the end
+   */
+  int peek(void) { return _position < _length ? _data[_position] : -1; }
+
+private:
+  uint8_t _data[256]; ///< The bytes written
+  size_t _length;     ///< Bytes written
+  size_t _position;   ///< Bytes read
+};
+
+TEST(recording_keeps_sample_settings_and_replay_leaves_bus_alone) {
+  SimSensorRig rig;
+  Adafruit_VCNL4040 sensor;
+  Adafruit_VCNL4040_Governor governor(&sensor);
+  MemoryStream recording;
+  Adafruit_VCNL4040_Recorder recorder(&sensor, &recording);
+  VCNL4040_Sample sample;
+
+  CHECK(sensor.begin());
+  recorder.begin();
+  // added last, so it sees each sample before the recorder does
+  CHECK(governor.begin());
+  rig.chip.setProximity(10);
+  SimClock::advanceMillis(100);
+  CHECK(sensor.readAll(&sample));
+  rig.chip.setProximity(2000);
+  SimClock::advanceMillis(100);
+  CHECK(sensor.readAll(&sample));
+  CHECK(governor.isFast());
+  CHECK_EQUAL(VCNL4040_LED_DUTY_1_320,
+              (sample.proximity_config >> 3) & 0x3);
+  recorder.end();
+  governor.end();
+
+  Adafruit_VCNL4040_Replay replay(&recording);
+  CHECK(replay.begin());
+  CHECK(replay.next(&sample));
+  CHECK(replay.next(&sample));
+  CHECK_EQUAL(2000, sample.proximity);
+  CHECK_EQUAL(VCNL4040_LED_DUTY_1_320, replay.getProximityLEDDutyCycle());
+
+  // replayed into the live sensor, the approach must not retune it
+  Adafruit_VCNL4040_Governor replay_governor(&sensor);
+  CHECK(replay_governor.begin());
+  sample.flags |= VCNL4040_SAMPLE_PROXIMITY_FRESH;
+  sample.proximity = 10;
+  sensor.replaySample(&sample);
+  sample.proximity = 2000;
+  SimCostMeter meter;
+  sensor.replaySample(&sample);
+  CHECK_EQUAL(0, meter.read().transactions);
+  CHECK(!replay_governor.isFast());
+}
@@ -0,0 +1,205 @@
+/*!
+ *  @file Adafruit_BusIO_Register.cpp
+ *
+ * 	Adafruit BusIO's register classes, built on any Adafruit_I2CDevice. The
+ * 	Linux port uses them with its i2c-dev device, and the host test harness
+ * 	with its simulated one.
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#include "Adafruit_BusIO_Register.h"
+
+/*!
+ *    @brief  Creates a register on an I2C device
+ *    @param  i2cdevice The device
+ *    @param  reg_addr The register's address
+ *    @param  width The number of bytes in the register, 1-4
+ *    @param  byteorder LSBFIRST or MSBFIRST
+ *    @param  address_width The number of bytes in the address, 1 or 2
+ */
+Adafruit_BusIO_Register::Adafruit_BusIO_Register(Adafruit_I2CDevice *i2cdevice,
+                                                 uint16_t reg_addr,
+                                                 uint8_t width,
+                                                 uint8_t byteorder,
+                                                 uint8_t address_width)
+    : _i2cdevice(i2cdevice), _address(reg_addr), _width(width),
+      _addrwidth(address_width), _byteorder(byteorder), _buffer(),
+      _cached(0) {}
+
+/*!
+ *    @brief  Writes bytes to the register
+ *    @param  buffer The bytes
+ *    @param  len The number of bytes
+ *    @return True if the write succeeded
+ */
+bool Adafruit_BusIO_Register::write(uint8_t *buffer, uint8_t len) {
+  uint8_t addrbuffer[2] = {(uint8_t)(_address & 0xFF),
+                           (uint8_t)(_address >> 8)};
+  return _i2cdevice->write(buffer, len, true, addrbuffer, _addrwidth);
+}
+
+/*!
+ *    @brief  Writes a value to the register
+ *    @param  value The value
+ *    @param  numbytes The number of bytes to write, or 0 for the register's
+ *            width
+ *    @return True if the write succeeded
+ */
+bool Adafruit_BusIO_Register::write(uint32_t value, uint8_t numbytes) {
+  if (numbytes == 0) {
+    numbytes = _width;
+  }
+  if (numbytes > 4) {
+    return false;
+  }
+  _cached = value;
+  for (uint8_t i = 0; i < numbytes; i++) {
+    if (_byteorder == LSBFIRST) {
+      _buffer[i] = value & 0xFF;
+    } else {
+      _buffer[numbytes - i - 1] = value & 0xFF;
+    }
+    value >>= 8;
+  }
+  return write(_buffer, numbytes);
+}
+
+/*!
+ *    @brief  Reads the register
+ *    @return The value, or all ones if the read failed
+ */
+uint32_t Adafruit_BusIO_Register::read(void) {
+  if (!read(_buffer, _width)) {
+    return -1;
+  }
+  uint32_t value = 0;
+  for (uint8_t i = 0; i < _width; i++) {
+    value <<= 8;
+    if (_byteorder == LSBFIRST) {
+      value |= _buffer[_width - i - 1];
+    } else {
+      value |= _buffer[i];
+    }
+  }
+  return value;
+}
+
+/*!
+ *    @brief  Gets the value last read or written, without the bus
+ *    @return The cached value
+ */
+uint32_t Adafruit_BusIO_Register::readCached(void) { return _cached; }
+
+/*!
+ *    @brief  Reads bytes from the register
+ *    @param  buffer Where to put the bytes
+ *    @param  len The number of bytes
+ *    @return True if the read succeeded
+ */
+bool Adafruit_BusIO_Register::read(uint8_t *buffer, uint8_t len) {
+  uint8_t addrbuffer[2] = {(uint8_t)(_address & 0xFF),
+                           (uint8_t)(_address >> 8)};
+  if (!_i2cdevice->write_then_read(addrbuffer, _addrwidth, buffer, len)) {
+    return false;
+  }
+  _cached = 0;
+  for (uint8_t i = 0; i < len && i < 4; i++) {
+    _cached |= (uint32_t)buffer[i] << (8 * i);
+  }
+  return true;
+}
+
+/*!
+ *    @brief  Reads a two-byte register
+ *    @param  value Where to store the value
+ *    @return True if the read succeeded
+ */
+bool Adafruit_BusIO_Register::read(uint16_t *value) {
+  if (!read(_buffer, 2)) {
+    return false;
+  }
+  if (_byteorder == LSBFIRST) {
+    *value = _buffer[0] | (_buffer[1] << 8);
+  } else {
+    *value = (_buffer[0] << 8) | _buffer[1];
+  }
+  return true;
+}
+
+/*!
+ *    @brief  Reads a one-byte register
+ *    @param  value Where to store the value
+ *    @return True if the read succeeded
+ */
+bool Adafruit_BusIO_Register::read(uint8_t *value) {
+  if (!read(_buffer, 1)) {
+    return false;
+  }
+  *value = _buffer[0];
+  return true;
+}
+
+/*!
+ *    @brief  Gets the register's width
+ *    @return The number of bytes in the register
+ */
+uint8_t Adafruit_BusIO_Register::width(void) { return _width; }
+
+/*!
+ *    @brief  Sets the register's width
+ *    @param  width The number of bytes in the register
+ */
+void Adafruit_BusIO_Register::setWidth(uint8_t width) { _width = width; }
+
+/*!
+ *    @brief  Sets the register's address
+ *    @param  address The address
+ */
+void Adafruit_BusIO_Register::setAddress(uint16_t address) {
+  _address = address;
+}
+
+/*!
+ *    @brief  Sets the width of the register's address
+ *    @param  address_width The number of bytes in the address
+ */
+void Adafruit_BusIO_Register::setAddressWidth(uint16_t address_width) {
+  _addrwidth = address_width;
+}
+
+/*!
+ *    @brief  Creates a field within a register
+ *    @param  reg The register
+ *    @param  bits The width of the field
+ *    @param  shift The position of the field's lowest bit
+ */
+Adafruit_BusIO_RegisterBits::Adafruit_BusIO_RegisterBits(
+    Adafruit_BusIO_Register *reg, uint8_t bits, uint8_t shift)
+    : _register(reg), _bits(bits), _shift(shift) {}
+
+/*!
+ *    @brief  Reads the field
+ *    @return The field's value
+ */
+uint32_t Adafruit_BusIO_RegisterBits::read(void) {
+  uint32_t value = _register->read();
+  value >>= _shift;
+  return value & ((1 << _bits) - 1);
+}
+
+/*!
+ *    @brief  Writes the field, with a read-modify-write of the register
+ *    @param  data The field's new value
+ *    @return True if the write succeeded
+ */
+bool Adafruit_BusIO_RegisterBits::write(uint32_t data) {
+  uint32_t value = _register->read();
+  uint32_t mask = (1 << _bits) - 1;
+
+  data &= mask;
+  mask <<= _shift;
+  value &= ~mask;
+  value |= data << _shift;
+  return _register->write(value, _register->width());
+}
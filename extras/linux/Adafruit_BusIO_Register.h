@@ -0,0 +1,66 @@
+/*!
+ *  @file Adafruit_BusIO_Register.h
+ *
+ * 	Adafruit BusIO's register classes, built on any Adafruit_I2CDevice. The
+ * 	Linux port uses them with its i2c-dev device, and the host test harness
+ * 	with its simulated one.
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#ifndef _LINUX_ADAFRUIT_BUSIO_REGISTER_H
+#define _LINUX_ADAFRUIT_BUSIO_REGISTER_H
+
+#include <Adafruit_I2CDevice.h>
+
+/*!
+ *    @brief  A register of up to four bytes on an I2C device, as in
+ *            Adafruit BusIO
+ */
+class Adafruit_BusIO_Register {
+public:
+  Adafruit_BusIO_Register(Adafruit_I2CDevice *i2cdevice, uint16_t reg_addr,
+                          uint8_t width = 1, uint8_t byteorder = LSBFIRST,
+                          uint8_t address_width = 1);
+
+  bool read(uint8_t *buffer, uint8_t len);
+  bool read(uint8_t *value);
+  bool read(uint16_t *value);
+  uint32_t read(void);
+  uint32_t readCached(void);
+  bool write(uint8_t *buffer, uint8_t len);
+  bool write(uint32_t value, uint8_t numbytes = 0);
+
+  uint8_t width(void);
+  void setWidth(uint8_t width);
+  void setAddress(uint16_t address);
+  void setAddressWidth(uint16_t address_width);
+
+private:
+  Adafruit_I2CDevice *_i2cdevice; ///< The device the register is on
+  uint16_t _address;              ///< The register's address
+  uint8_t _width;                 ///< Bytes in the register
+  uint8_t _addrwidth;             ///< Bytes in the address
+  uint8_t _byteorder;             ///< LSBFIRST or MSBFIRST
+  uint8_t _buffer[4];             ///< The bytes last transferred
+  uint32_t _cached;               ///< The value last transferred
+};
+
+/*!
+ *    @brief  A field of bits within an `Adafruit_BusIO_Register`, as in
+ *            Adafruit BusIO. Each write reads the register first.
+ */
+class Adafruit_BusIO_RegisterBits {
+public:
+  Adafruit_BusIO_RegisterBits(Adafruit_BusIO_Register *reg, uint8_t bits,
+                              uint8_t shift);
+  bool write(uint32_t value);
+  uint32_t read(void);
+
+private:
+  Adafruit_BusIO_Register *_register; ///< The register holding the field
+  uint8_t _bits;                      ///< Width of the field
+  uint8_t _shift;                     ///< Position of the field
+};
+
+#endif
@@ -0,0 +1,178 @@
+/*!
+ *  @file Adafruit_I2CDevice.cpp
+ *
+ * 	Adafruit BusIO's I2C device for Linux, on an i2c-dev bus
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#include "Adafruit_I2CDevice.h"
+
+#include <linux/i2c-dev.h>
+
+/*!
+ *    @brief  Creates a device on a bus, not yet begun
+ *    @param  addr The device's 7-bit I2C address
+ *    @param  theWire The bus the device is on
+ */
+Adafruit_I2CDevice::Adafruit_I2CDevice(uint8_t addr, TwoWire *theWire)
+    : _addr(addr), _wire(theWire), _begun(false) {}
+
+/*!
+ *    @brief  Opens the bus and, like BusIO, checks that the device ACKs
+ *    @param  addr_detect Whether to check for the device
+ *    @return True if the bus opened and the device was found or not looked
+ *            for
+ */
+bool Adafruit_I2CDevice::begin(bool addr_detect) {
+  if (!_wire->begin()) {
+    return false;
+  }
+  _begun = true;
+  if (addr_detect) {
+    return detected();
+  }
+  return true;
+}
+
+/*!
+ *    @brief  Closes the bus
+ */
+void Adafruit_I2CDevice::end(void) {
+  _wire->end();
+  _begun = false;
+}
+
+/*!
+ *    @brief  Checks that the device ACKs its address with an empty write
+ *    @return True if the device was found
+ */
+bool Adafruit_I2CDevice::detected(void) {
+  struct i2c_msg message = {_addr, 0, 0, NULL};
+
+  if (!_begun && !begin(false)) {
+    return false;
+  }
+  return _wire->transfer(&message, 1);
+}
+
+/*!
+ *    @brief  Reads bytes from the device
+ *    @param  buffer Where to put the bytes
+ *    @param  len The number of bytes to read
+ *    @param  stop Ignored; i2c-dev always ends a transaction with a STOP
+ *    @return True if every byte was read
+ */
+bool Adafruit_I2CDevice::read(uint8_t *buffer, size_t len, bool stop) {
+  struct i2c_msg message = {_addr, I2C_M_RD, (uint16_t)len, buffer};
+
+  (void)stop;
+  if (len > maxBufferSize()) {
+    return false;
+  }
+  return _wire->transfer(&message, 1);
+}
+
+/*!
+ *    @brief  Writes bytes to the device, after an optional prefix, in one
+ *            message
+ *    @param  buffer The bytes to write
+ *    @param  len The number of bytes to write
+ *    @param  stop Ignored; i2c-dev always ends a transaction with a STOP
+ *    @param  prefix_buffer Bytes to write first, or NULL
+ *    @param  prefix_len The number of prefix bytes
+ *    @return True if the write was ACKed
+ */
+bool Adafruit_I2CDevice::write(const uint8_t *buffer, size_t len, bool stop,
+                               const uint8_t *prefix_buffer,
+                               size_t prefix_len) {
+  uint8_t data[LINUX_WIRE_BUFFER];
+  struct i2c_msg message = {_addr, 0, (uint16_t)(prefix_len + len), data};
+
+  (void)stop;
+  if (len + prefix_len > maxBufferSize()) {
+    return false;
+  }
+  if (prefix_len) {
+    memcpy(data, prefix_buffer, prefix_len);
+  }
+  memcpy(data + prefix_len, buffer, len);
+  return _wire->transfer(&message, 1);
+}
+
+/*!
+ *    @brief  Writes bytes then reads bytes, joined by a repeated START, in
+ *            one ioctl
+ *    @param  write_buffer The bytes to write
+ *    @param  write_len The number of bytes to write
+ *    @param  read_buffer Where to put the bytes read
+ *    @param  read_len The number of bytes to read
+ *    @param  stop Ignored; the halves are always joined by a repeated START
+ *    @return True if both halves succeeded
+ */
+bool Adafruit_I2CDevice::write_then_read(const uint8_t *write_buffer,
+                                         size_t write_len, uint8_t *read_buffer,
+                                         size_t read_len, bool stop) {
+  struct i2c_msg messages[2] = {
+      {_addr, 0, (uint16_t)write_len, (uint8_t *)write_buffer},
+      {_addr, I2C_M_RD, (uint16_t)read_len, read_buffer}};
+
+  (void)stop;
+  if (write_len > maxBufferSize() || read_len > maxBufferSize()) {
+    return false;
+  }
+  return _wire->transfer(messages, 2);
+}
+
+/*!
+ *    @brief  Reads several registers in one ioctl: for each one, its command
+ *            code is written and its value read back after a repeated START.
+ *            Not part of BusIO; drivers check for
+ *            `ADAFRUIT_I2CDEVICE_READ_REGISTERS` before using it.
+ *    @param  registers The one-byte command code of each register
+ *    @param  count The number of registers, at most half of
+ *            `I2C_RDWR_IOCTL_MAX_MSGS`
+ *    @param  buffer Where to put the values, `width` bytes per register in
+ *            the order of `registers`
+ *    @param  width The number of bytes in each register
+ *    @return True if every register was read
+ */
+bool Adafruit_I2CDevice::read_registers(const uint8_t *registers,
+                                        size_t count, uint8_t *buffer,
+                                        size_t width) {
+  struct i2c_msg messages[I2C_RDWR_IOCTL_MAX_MSGS];
+
+  if (count == 0 || count > I2C_RDWR_IOCTL_MAX_MSGS / 2 ||
+      width > maxBufferSize()) {
+    return false;
+  }
+  for (size_t i = 0; i < count; i++) {
+    struct i2c_msg *pair = &messages[2 * i];
+
+    pair[0].addr = _addr;
+    pair[0].flags = 0;
+    pair[0].len = 1;
+    pair[0].buf = (uint8_t *)&registers[i];
+    pair[1].addr = _addr;
+    pair[1].flags = I2C_M_RD;
+    pair[1].len = width;
+    pair[1].buf = buffer + i * width;
+  }
+  return _wire->transfer(messages, 2 * count);
+}
+
+/*!
+ *    @brief  Gets the device's address
+ *    @return The 7-bit I2C address
+ */
+uint8_t Adafruit_I2CDevice::address(void) { return _addr; }
+
+/*!
+ *    @brief  Can't set the bus clock, which the kernel's device tree sets
+ *    @param  desiredclk The frequency in Hz
+ *    @return False
+ */
+bool Adafruit_I2CDevice::setSpeed(uint32_t desiredclk) {
+  (void)desiredclk;
+  return false;
+}
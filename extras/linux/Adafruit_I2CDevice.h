@@ -0,0 +1,54 @@
+/*!
+ *  @file Adafruit_I2CDevice.h
+ *
+ * 	Adafruit BusIO's I2C device for Linux, on an i2c-dev bus. Each call is
+ * 	one I2C_RDWR ioctl, so a register read is a write-then-read message pair
+ * 	joined by a repeated START, in one system call.
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#ifndef _LINUX_ADAFRUIT_I2CDEVICE_H
+#define _LINUX_ADAFRUIT_I2CDEVICE_H
+
+#include <Wire.h>
+
+/// `read_registers` is available, so drivers can batch register reads
+#define ADAFRUIT_I2CDEVICE_READ_REGISTERS
+
+/*!
+ *    @brief  An I2C device on a `TwoWire` bus, with BusIO's interface. The
+ *            device only keeps its address and bus, so it can be copied
+ *            freely; the bus owns the open file.
+ */
+class Adafruit_I2CDevice {
+public:
+  Adafruit_I2CDevice(uint8_t addr, TwoWire *theWire = &Wire);
+  uint8_t address(void);
+  bool begin(bool addr_detect = true);
+  void end(void);
+  bool detected(void);
+
+  bool read(uint8_t *buffer, size_t len, bool stop = true);
+  bool write(const uint8_t *buffer, size_t len, bool stop = true,
+             const uint8_t *prefix_buffer = NULL, size_t prefix_len = 0);
+  bool write_then_read(const uint8_t *write_buffer, size_t write_len,
+                       uint8_t *read_buffer, size_t read_len,
+                       bool stop = false);
+  bool read_registers(const uint8_t *registers, size_t count,
+                      uint8_t *buffer, size_t width);
+  bool setSpeed(uint32_t desiredclk);
+
+  /*!
+   *    @brief  How many bytes we can read in a transaction
+   *    @return The largest read or write, matching an Arduino's buffer
+   */
+  size_t maxBufferSize() { return LINUX_WIRE_BUFFER; }
+
+private:
+  uint8_t _addr;  ///< The device's I2C address
+  TwoWire *_wire; ///< The bus the device is on
+  bool _begun;    ///< begin() has been called
+};
+
+#endif
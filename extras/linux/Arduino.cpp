@@ -0,0 +1,62 @@
+/*!
+ *  @file Arduino.cpp
+ *
+ * 	Arduino timing functions on the Linux monotonic clock
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#include "Arduino.h"
+
+#include <errno.h>
+#include <time.h>
+
+/*!
+ *    @brief  Reads the monotonic clock
+ *    @return The time in microseconds since an arbitrary start
+ */
+static uint64_t monotonicMicros(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/*!
+ *    @brief  Gets the time in milliseconds
+ *    @return The time since an arbitrary start, wrapping like the Arduino
+ *            core's
+ */
+uint32_t millis(void) { return (uint32_t)(monotonicMicros() / 1000); }
+
+/*!
+ *    @brief  Gets the time in microseconds
+ *    @return The time since an arbitrary start, wrapping like the Arduino
+ *            core's
+ */
+uint32_t micros(void) { return (uint32_t)monotonicMicros(); }
+
+/*!
+ *    @brief  Sleeps for a while, resuming after signals
+ *    @param  us The time to sleep for, in microseconds
+ */
+static void sleepMicros(uint64_t us) {
+  struct timespec remaining;
+
+  remaining.tv_sec = us / 1000000;
+  remaining.tv_nsec = (us % 1000000) * 1000;
+  while (nanosleep(&remaining, &remaining) != 0 && errno == EINTR) {
+  }
+}
+
+/*!
+ *    @brief  Sleeps for a while
+ *    @param  ms The time to sleep for, in milliseconds
+ */
+void delay(uint32_t ms) { sleepMicros((uint64_t)ms * 1000); }
+
+/*!
+ *    @brief  Sleeps for a while
+ *    @param  us The time to sleep for, in microseconds
+ */
+void delayMicroseconds(uint32_t us) { sleepMicros(us); }
@@ -0,0 +1,126 @@
+/*!
+ *  @file Arduino.h
+ *
+ * 	The parts of the Arduino core used by the VCNL4040 library, for
+ * 	building it on Linux. Time comes from the monotonic clock. There are no
+ * 	pin interrupts, so `attachInterruptPin` is refused and the sensor is
+ * 	polled instead.
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#ifndef _LINUX_ARDUINO_H
+#define _LINUX_ARDUINO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef bool boolean; ///< Arduino's name for bool
+typedef uint8_t byte; ///< Arduino's name for uint8_t
+
+#define LSBFIRST 0          ///< Least significant byte first
+#define MSBFIRST 1          ///< Most significant byte first
+#define INPUT 0             ///< Pin mode: input
+#define OUTPUT 1            ///< Pin mode: output
+#define INPUT_PULLUP 2      ///< Pin mode: input with pullup
+#define CHANGE 1            ///< Interrupt on any edge
+#define FALLING 2           ///< Interrupt on a falling edge
+#define RISING 3            ///< Interrupt on a rising edge
+#define NOT_AN_INTERRUPT -1 ///< Returned for pins without an interrupt
+#define PROGMEM             ///< Flash storage, plain memory on Linux
+
+#define pgm_read_byte(p) (*(const uint8_t *)(p))  ///< Reads a PROGMEM byte
+#define pgm_read_word(p) (*(const uint16_t *)(p)) ///< Reads a PROGMEM word
+
+uint32_t millis(void);
+uint32_t micros(void);
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+/*!
+ *    @brief  Does nothing; the kernel schedules other work
+ */
+inline void yield(void) {}
+
+/*!
+ *    @brief  Does nothing; GPIO is not handled by this port
+ */
+inline void pinMode(uint8_t, uint8_t) {}
+
+/*!
+ *    @brief  Maps a pin to its interrupt. No pin has one on this port.
+ *    @return `NOT_AN_INTERRUPT`
+ */
+inline int digitalPinToInterrupt(int) { return NOT_AN_INTERRUPT; }
+
+/*!
+ *    @brief  Does nothing; there are no pin interrupts
+ */
+inline void attachInterrupt(int, void (*)(void), int) {}
+
+/*!
+ *    @brief  Does nothing; there are no pin interrupts
+ */
+inline void detachInterrupt(int) {}
+
+/*!
+ *    @brief  Does nothing; there are no interrupt handlers to mask
+ */
+inline void noInterrupts(void) {}
+
+/*!
+ *    @brief  Does nothing; there are no interrupt handlers to mask
+ */
+inline void interrupts(void) {}
+
+/*!
+ *    @brief  The byte output interface of the Arduino core
+ */
+class Print {
+public:
+  virtual ~Print() {}
+  /*!
+   *    @brief  Writes one byte
+   *    @param  value The byte to write
+   *    @return The number of bytes written
+   */
+  virtual size_t write(uint8_t value) = 0;
+  /*!
+   *    @brief  Writes a buffer, one byte at a time
+   *    @param  buffer The bytes to write
+   *    @param  size The number of bytes to write
+   *    @return The number of bytes written
+   */
+  virtual size_t write(const uint8_t *buffer, size_t size) {
+    size_t written = 0;
+    while (written < size && write(buffer[written])) {
+      written++;
+    }
+    return written;
+  }
+};
+
+/*!
+ *    @brief  The byte input interface of the Arduino core
+ */
+class Stream : public Print {
+public:
+  /*!
+   *    @brief  Gets the number of bytes that can be read
+   *    @return The number of bytes available
+   */
+  virtual int available(void) = 0;
+  /*!
+   *    @brief  Reads one byte
+   *    @return The byte, or -1 if none is available
+   */
+  virtual int read(void) = 0;
+  /*!
+   *    @brief  Gets the next byte without reading it
+   *    @return The byte, or -1 if none is available
+   */
+  virtual int peek(void) = 0;
+};
+
+#endif
@@ -0,0 +1,131 @@
+/*!
+ *  @file Wire.cpp
+ *
+ * 	An I2C bus on Linux, reached through its i2c-dev character device
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#include "Wire.h"
+
+#include <fcntl.h>
+#include <linux/i2c-dev.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+TwoWire Wire("/dev/i2c-1");
+
+/*!
+ *    @brief  Names a bus without opening it
+ *    @param  device The path of the bus's i2c-dev device, e.g. /dev/i2c-1
+ */
+TwoWire::TwoWire(const char *device)
+    : _device(device), _fd(-1), _tx_address(0), _tx_length(0),
+      _tx_overflow(false) {}
+
+/*!
+ *    @brief  Closes the bus
+ */
+TwoWire::~TwoWire(void) { end(); }
+
+/*!
+ *    @brief  Opens the bus, if it isn't open already
+ *    @return True if the bus is open
+ */
+bool TwoWire::begin(void) {
+  if (_fd < 0) {
+    _fd = open(_device, O_RDWR);
+  }
+  return _fd >= 0;
+}
+
+/*!
+ *    @brief  Closes the bus
+ */
+void TwoWire::end(void) {
+  if (_fd >= 0) {
+    close(_fd);
+    _fd = -1;
+  }
+}
+
+/*!
+ *    @brief  Ignored; the bus clock is set by the kernel
+ *    @param  frequency The requested SCL frequency in Hz
+ */
+void TwoWire::setClock(uint32_t frequency) { (void)frequency; }
+
+/*!
+ *    @brief  Runs messages on the bus as one transaction: each after a
+ *            START or repeated START, and a STOP after the last
+ *    @param  messages The messages, each with its address, flags and data
+ *    @param  count The number of messages, at most
+ *            `I2C_RDWR_IOCTL_MAX_MSGS`
+ *    @return True if every message was ACKed
+ */
+bool TwoWire::transfer(struct i2c_msg *messages, uint8_t count) {
+  struct i2c_rdwr_ioctl_data transaction;
+
+  if (!begin() || count == 0 || count > I2C_RDWR_IOCTL_MAX_MSGS) {
+    return false;
+  }
+  transaction.msgs = messages;
+  transaction.nmsgs = count;
+  // the kernel returns the number of messages run
+  return ioctl(_fd, I2C_RDWR, &transaction) == count;
+}
+
+/*!
+ *    @brief  Starts collecting bytes to write to a device
+ *    @param  address The device's 7-bit address
+ */
+void TwoWire::beginTransmission(uint8_t address) {
+  _tx_address = address;
+  _tx_length = 0;
+  _tx_overflow = false;
+}
+
+/*!
+ *    @brief  Adds a byte to the transmission
+ *    @param  value The byte
+ *    @return 1, or 0 if the transmission is full
+ */
+size_t TwoWire::write(uint8_t value) { return write(&value, 1); }
+
+/*!
+ *    @brief  Adds bytes to the transmission
+ *    @param  buffer The bytes
+ *    @param  size The number of bytes
+ *    @return The number of bytes added
+ */
+size_t TwoWire::write(const uint8_t *buffer, size_t size) {
+  size_t room = LINUX_WIRE_BUFFER - _tx_length;
+
+  if (size > room) {
+    size = room;
+    _tx_overflow = true;
+  }
+  memcpy(_tx_buffer + _tx_length, buffer, size);
+  _tx_length += size;
+  return size;
+}
+
+/*!
+ *    @brief  Writes the transmission to the device in one message
+ *    @param  stop Ignored; i2c-dev always ends a transaction with a STOP
+ *    @return 0 on success, 1 if the bytes didn't fit, 4 if the write failed,
+ *            as Arduino's `endTransmission`
+ */
+uint8_t TwoWire::endTransmission(bool stop) {
+  struct i2c_msg message;
+
+  (void)stop;
+  if (_tx_overflow) {
+    return 1;
+  }
+  message.addr = _tx_address;
+  message.flags = 0;
+  message.len = _tx_length;
+  message.buf = _tx_buffer;
+  return transfer(&message, 1) ? 0 : 4;
+}
@@ -0,0 +1,64 @@
+/*!
+ *  @file Wire.h
+ *
+ * 	An I2C bus on Linux, reached through its i2c-dev character device,
+ * 	e.g. /dev/i2c-1. Every transfer is one I2C_RDWR ioctl, which carries a
+ * 	run of messages joined by repeated STARTs and ended by one STOP.
+ *
+ * 	BSD license (see license.txt)
+ */
+
+#ifndef _LINUX_WIRE_H
+#define _LINUX_WIRE_H
+
+#include "Arduino.h"
+
+#include <linux/i2c.h>
+
+#define LINUX_WIRE_BUFFER 32 ///< Bytes per Arduino-style transmission
+
+/*!
+ *    @brief  An I2C bus behind an i2c-dev character device. The bus clock
+ *            is set by the kernel's device tree, not from user space.
+ *
+ *            The Arduino-style `beginTransmission`, `write` and
+ *            `endTransmission` calls are kept for code that writes to the
+ *            bus directly, such as `Adafruit_VCNL4040_Group`'s mux writes.
+ *            Device drivers go through `Adafruit_I2CDevice`, which builds
+ *            its messages and sends them with `transfer`.
+ */
+class TwoWire {
+public:
+  TwoWire(const char *device);
+  TwoWire(const TwoWire &) = delete;
+  TwoWire &operator=(const TwoWire &) = delete;
+  ~TwoWire(void);
+
+  bool begin(void);
+  void end(void);
+  void setClock(uint32_t frequency);
+  bool transfer(struct i2c_msg *messages, uint8_t count);
+
+  void beginTransmission(uint8_t address);
+  size_t write(uint8_t value);
+  size_t write(const uint8_t *buffer, size_t size);
+  uint8_t endTransmission(bool stop = true);
+
+  /*!
+   *    @brief  Gets the path of the bus's character device
+   *    @return The path, e.g. /dev/i2c-1
+   */
+  const char *device(void) { return _device; }
+
+private:
+  const char *_device;                   ///< Path of the i2c-dev device
+  int _fd;                               ///< Open device, or -1
+  uint8_t _tx_address;                   ///< Transmission's address
+  uint8_t _tx_buffer[LINUX_WIRE_BUFFER]; ///< Transmission's bytes
+  uint8_t _tx_length;                    ///< Bytes in `_tx_buffer`
+  bool _tx_overflow;                     ///< A write didn't fit
+};
+
+extern TwoWire Wire; ///< /dev/i2c-1, the header bus on most Linux boards
+
+#endif